@@ -1,6 +1,7 @@
 // Copyright(c) 2023 Ryan Seghers
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 #pragma once
+#include <functional>
 
 namespace CppOpenCVUtil
 {
@@ -49,6 +50,23 @@ namespace CppOpenCVUtil
              * @brief Whether or not to put captions under each image.
              */
             bool doCaptions = true;
+
+            /**
+             * @brief Whether captions that are too wide end in "..." when shortened, instead of just being cut off.
+             */
+            bool doCaptionEllipsis = false;
         };
+
+        /**
+         * @brief Receives a collage a band of rows at a time, see renderCollageBands.
+         * The band is only valid during the call, and y is the collage row of its top.
+         */
+        using CollageBandSink = std::function<void(const cv::Mat& band, int y)>;
+
+        /**
+         * @brief Loads collage image i on demand, see renderCollage. tileSize is the size the image will be scaled to (empty
+         * if not known yet), so a loader can decode at reduced resolution.
+         */
+        using CollageImageLoader = std::function<cv::Mat(int i, cv::Size tileSize)>;
     }
 }
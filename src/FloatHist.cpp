@@ -1,13 +1,15 @@
 // Copyright(c) 2022 Ryan Seghers
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 #include <string>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
 
 #include <opencv2/opencv.hpp>
 #include <fmt/core.h>
 
 #include "FloatHist.h"
 #include "MiscUtil.h"
-#include "MathUtil.h"
 
 using namespace std;
 using namespace CppBaseUtil;
@@ -16,16 +18,20 @@ namespace CppOpenCVUtil
 {
     void FloatHist::copy(FloatHist& other)
     {
+        this->binMode = other.binMode;
         this->minVal = other.minVal;
         this->maxVal = other.maxVal;
         this->counts = other.counts;
         this->bins = other.bins;
+        this->cumulativeValid = false;
     }
 
     void FloatHist::clear()
     {
         this->counts.clear();
         this->bins.clear();
+        this->cumulativeValid = false;
+        this->binMode = FloatHistBinMode::Uniform;
         this->minVal = 0.0f;
         this->maxVal = 0.0f;
     }
@@ -40,9 +46,12 @@ namespace CppOpenCVUtil
         return (int)this->bins.size();
     }
 
+    /**
+     * @brief Size of each bin for uniform bins, NAN for other bin modes.
+     */
     float FloatHist::getBinSize()
     {
-        if (this->bins.size() > 1)
+        if ((binMode == FloatHistBinMode::Uniform) && (this->bins.size() > 1))
         {
             return this->bins[1] - this->bins[0];
         }
@@ -62,86 +71,714 @@ namespace CppOpenCVUtil
         return this->maxVal;
     }
 
+    /**
+     * @brief Min and max of the finite values, branch-free so it vectorizes for unit stride.
+     * @return false if there are no finite values.
+     */
+    static bool findFiniteMinMax(const float* values, int count, ptrdiff_t stride, float& foundMin, float& foundMax)
+    {
+        float mn = FLT_MAX;
+        float mx = -FLT_MAX;
+        int finiteCount = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            float v = values[i * stride];
+            bool isFinite = std::abs(v) <= FLT_MAX;
+            mn = (isFinite && (v < mn)) ? v : mn;
+            mx = (isFinite && (v > mx)) ? v : mx;
+            finiteCount += isFinite;
+        }
+
+        foundMin = std::min(foundMin, mn);
+        foundMax = std::max(foundMax, mx);
+        return finiteCount > 0;
+    }
+
+    /**
+     * @brief Fill in NAN range ends from the found range of the values.
+     * @return false if a range end is needed but there were no finite values.
+     */
+    static bool resolveRange(float& minVal, float& maxVal, bool found, float foundMin, float foundMax)
+    {
+        if (!std::isnan(minVal) && !std::isnan(maxVal))
+        {
+            return true;
+        }
+
+        if (!found)
+        {
+            return false;
+        }
+
+        if (std::isnan(minVal))
+        {
+            minVal = foundMin;
+
+            // almost always want min to be 0, unless actual values go lt 0
+            if (minVal > 0)
+            {
+                minVal = 0;
+            }
+        }
+
+        if (std::isnan(maxVal))
+        {
+            maxVal = foundMax + std::numeric_limits<float>::epsilon();
+        }
+
+        return true;
+    }
+
     /**
      * @brief
      * @param values
      * @param binCount
-     * @param inMinVal If NAN then is set to minimum good value in the input vector, or 0 if that value is gt 0.
-     * @param inMaxVal If NAN then is set to maximum good value in the input vector.
+     * @param inMinVal If NAN then is set to minimum good value in the input, or 0 if that value is gt 0.
+     * @param inMaxVal If NAN then is set to maximum good value in the input.
      */
+    void FloatHist::compute(std::span<const float> values, int binCount, float inMinVal, float inMaxVal)
+    {
+        compute(values.data(), (int)values.size(), 1, binCount, inMinVal, inMaxVal);
+    }
+
     void FloatHist::compute(const std::vector<float>& values, int binCount, float inMinVal, float inMaxVal)
     {
+        compute(values.data(), (int)values.size(), 1, binCount, inMinVal, inMaxVal);
+    }
+
+    /**
+     * @brief Compute from strided values, e.g. a column of a matrix or one channel of interleaved data.
+     * @param values
+     * @param count Number of values.
+     * @param stride Distance between values, in floats.
+     * @param binCount
+     * @param inMinVal See compute(span).
+     * @param inMaxVal See compute(span).
+     */
+    void FloatHist::compute(const float* values, int count, ptrdiff_t stride, int binCount, float inMinVal, float inMaxVal)
+    {
+        float foundMin = FLT_MAX;
+        float foundMax = -FLT_MAX;
+        bool found = false;
+
+        if (std::isnan(inMinVal) || std::isnan(inMaxVal))
+        {
+            found = findFiniteMinMax(values, count, stride, foundMin, foundMax);
+        }
+
+        if (!resolveRange(inMinVal, inMaxVal, found, foundMin, foundMax))
+        {
+            // empty hist
+            clear();
+            return;
+        }
+
+        init(binCount, inMinVal, inMaxVal);
+        add(values, count, stride);
+    }
+
+    /**
+     * @brief Compute from all values of a 32F single-channel matrix, row by row (no copy for non-continuous).
+     */
+    void FloatHist::compute(const cv::Mat& values, int binCount, float inMinVal, float inMaxVal)
+    {
+        CV_Assert(values.type() == CV_32F);
+        float foundMin = FLT_MAX;
+        float foundMax = -FLT_MAX;
+        bool found = false;
+
+        if (std::isnan(inMinVal) || std::isnan(inMaxVal))
+        {
+            for (int y = 0; y < values.rows; y++)
+            {
+                found |= findFiniteMinMax(values.ptr<float>(y), values.cols, 1, foundMin, foundMax);
+            }
+        }
+
+        if (!resolveRange(inMinVal, inMaxVal, found, foundMin, foundMax))
+        {
+            clear();
+            return;
+        }
+
+        init(binCount, inMinVal, inMaxVal);
+        add(values);
+    }
+
+    /**
+     * @brief Zero the counts, keeping the storage if the size is unchanged.
+     */
+    static void resetCounts(FloatHist& hist, int binCount)
+    {
+        std::vector<int>& counts = hist.counts;
+        hist.invalidateCumulative();
+
+        if ((int)counts.size() == binCount)
+        {
+            std::fill(counts.begin(), counts.end(), 0);
+        }
+        else
+        {
+            counts.assign(binCount, 0);
+        }
+    }
+
+    /**
+     * @brief Set up empty uniform bins. Storage is kept (no allocation) when the bin count is unchanged, and the bin
+     * bottoms are only recomputed if the range changed.
+     */
+    void FloatHist::init(int binCount, float inMinVal, float inMaxVal)
+    {
+        if (inMaxVal <= inMinVal)
+        {
+            // all same value
+            binCount = 1;
+        }
+
+        bool sameBins = (binMode == FloatHistBinMode::Uniform) && ((int)bins.size() == binCount) && (minVal == inMinVal) && (maxVal == inMaxVal);
+        this->binMode = FloatHistBinMode::Uniform;
         this->minVal = inMinVal;
         this->maxVal = inMaxVal;
+        resetCounts(*this, binCount);
 
-        if (std::isnan(minVal) || std::isnan(maxVal))
+        if (!sameBins)
         {
-            float foundMin, foundMax;
+            bins.resize(binCount);
+            float binSize = (maxVal - minVal) / binCount;
 
-            if (vectorMinMax(values, foundMin, foundMax))
+            for (int i = 0; i < binCount; i++)
             {
-                if (std::isnan(minVal))
-                {
-                    minVal = foundMin;
+                bins[i] = minVal + i * binSize;
+            }
+        }
+    }
 
-                    // almost always want min to be 0, unless actual values go lt 0
-                    if (minVal > 0)
-                    {
-                        minVal = 0;
-                    }
-                }
+    /**
+     * @brief Set up empty log-spaced bins, each bin covers the same ratio of values. For data spanning several decades.
+     * @param binCount
+     * @param inMinVal Bottom of first bin, must be gt 0.
+     * @param inMaxVal Top of last bin.
+     */
+    void FloatHist::initLog(int binCount, float inMinVal, float inMaxVal)
+    {
+        CV_Assert((inMinVal > 0.0f) && (inMaxVal > inMinVal) && (binCount > 0));
 
-                if (std::isnan(maxVal))
-                {
-                    maxVal = foundMax + std::numeric_limits<float>::epsilon();
-                }
+        bool sameBins = (binMode == FloatHistBinMode::Log) && ((int)bins.size() == binCount) && (minVal == inMinVal) && (maxVal == inMaxVal);
+        this->binMode = FloatHistBinMode::Log;
+        this->minVal = inMinVal;
+        this->maxVal = inMaxVal;
+        resetCounts(*this, binCount);
+
+        if (!sameBins)
+        {
+            bins.resize(binCount);
+            double logMin = std::log((double)minVal);
+            double logStep = (std::log((double)maxVal) - logMin) / binCount;
+
+            for (int i = 0; i < binCount; i++)
+            {
+                bins[i] = (float)std::exp(logMin + i * logStep);
+            }
+
+            bins[0] = minVal;
+        }
+    }
+
+    /**
+     * @brief Set up empty bins with arbitrary edges.
+     * @param edges Bin edges in increasing order, binCount + 1 of them. The first is minVal and the last is maxVal.
+     */
+    void FloatHist::initEdges(std::span<const float> edges)
+    {
+        CV_Assert(edges.size() >= 2);
+        int binCount = (int)edges.size() - 1;
+
+        for (int i = 0; i < binCount; i++)
+        {
+            CV_Assert(edges[i] < edges[i + 1]);
+        }
+
+        binMode = FloatHistBinMode::Edges;
+        minVal = edges[0];
+        maxVal = edges[binCount];
+        resetCounts(*this, binCount);
+        bins.assign(edges.begin(), edges.end() - 1);
+    }
+
+    /**
+     * @brief What the binning loop needs from the hist, set up once per call.
+     */
+    struct BinLookup
+    {
+        float minVal;
+        float hi;
+        float offset;
+        float scale;
+        const float* bins;
+        int binCount;
+    };
+
+    /**
+     * @brief Bin index for a value and whether to count it (0 or 1), without branches.
+     * Non-finite values go in the last bin, as they always have, and values outside minVal to maxVal get weight 0.
+     * Uniform is a multiply by a precomputed reciprocal, log is the same on log(v), and edges is a branchless binary
+     * search (a fixed log2(binCount) steps of conditional moves, no mispredicts).
+     */
+    template <FloatHistBinMode Mode>
+    static inline int findBin(float v, const BinLookup& lookup, int& weight)
+    {
+        bool isFinite = std::abs(v) <= FLT_MAX;
+        bool inRange = (v >= lookup.minVal) && (v <= lookup.hi);
+        weight = (int)(inRange || !isFinite);
+        int idx;
+
+        if constexpr (Mode == FloatHistBinMode::Edges)
+        {
+            const float* base = lookup.bins;
+            int n = lookup.binCount;
+
+            while (n > 1)
+            {
+                int half = n / 2;
+                base = (base[half] <= v) ? base + half : base;
+                n -= half;
+            }
+
+            idx = (int)(base - lookup.bins);
+        }
+        else
+        {
+            float x = (Mode == FloatHistBinMode::Log) ? std::log(v) : v;
+            float t = (x - lookup.offset) * lookup.scale;
+            float lastBin = (float)(lookup.binCount - 1);
+            t = (t > 0.0f) ? t : 0.0f; // also takes NAN to 0
+            t = (t < lastBin) ? t : lastBin; // if maxVal is == max in array then at least one idx would go over
+            idx = (int)t;
+        }
+
+        return isFinite ? idx : (lookup.binCount - 1);
+    }
+
+    /**
+     * @brief Bin values into counts without branches.
+     * Indexes for a batch of values are computed first, which vectorizes for uniform bins, then scattered.
+     * Dropped values get weight 0 rather than a branch.
+     */
+    template <FloatHistBinMode Mode, bool UnitStride>
+    static void binValues(const float* values, int count, ptrdiff_t stride, const BinLookup& lookup, int* counts)
+    {
+        const int batchSize = 64;
+        int idxs[batchSize];
+        int weights[batchSize];
+
+        for (int i0 = 0; i0 < count; i0 += batchSize)
+        {
+            int n = std::min(batchSize, count - i0);
+
+            for (int k = 0; k < n; k++)
+            {
+                float v = UnitStride ? values[i0 + k] : values[(i0 + k) * stride];
+                idxs[k] = findBin<Mode>(v, lookup, weights[k]);
             }
-            else
+
+            for (int k = 0; k < n; k++)
             {
-                // empty hist
-                bins.resize(0);
-                counts.resize(0);
-                return;
+                counts[idxs[k]] += weights[k];
             }
         }
+    }
 
-        if (maxVal <= minVal)
+    template <FloatHistBinMode Mode>
+    static void binValues(const float* values, int count, ptrdiff_t stride, const BinLookup& lookup, int* counts)
+    {
+        if (stride == 1)
         {
-            // all same value
-            bins.resize(1);
-            bins[0] = minVal;
-            counts.resize(1);
-            counts[0] = 0;
+            binValues<Mode, true>(values, count, 1, lookup, counts);
         }
         else
         {
-            // bins
-            bins.resize(binCount);
-            counts.resize(binCount);
-            float binSize = (maxVal - minVal) / binCount;
+            binValues<Mode, false>(values, count, stride, lookup, counts);
+        }
+    }
 
+    /**
+     * @brief Bins per unit of value for uniform bins, or per unit of log(value) for log bins. Not used for edges.
+     */
+    float FloatHist::getBinScale()
+    {
+        int binCount = (int)counts.size();
+
+        if (binCount <= 1)
+        {
+            return 0.0f;
+        }
+        else if (binMode == FloatHistBinMode::Log)
+        {
+            return binCount / (std::log(maxVal) - std::log(minVal));
+        }
+        else
+        {
+            return binCount / (maxVal - minVal);
+        }
+    }
+
+    /**
+     * @brief Add one value to the hist. Bins must already be set up by compute() or one of the init functions.
+     * Values outside minVal to maxVal are ignored, like compute().
+     */
+    void FloatHist::add(float value)
+    {
+        add(&value, 1, 1);
+    }
+
+    /**
+     * @brief Add values to the hist, without clearing it. Bins must already be set up by compute() or one of the init functions.
+     */
+    void FloatHist::add(std::span<const float> values)
+    {
+        add(values.data(), (int)values.size(), 1);
+    }
+
+    void FloatHist::add(const std::vector<float>& values)
+    {
+        add(values.data(), (int)values.size(), 1);
+    }
+
+    /**
+     * @brief Add strided values to the hist, without clearing it.
+     * @param values
+     * @param count Number of values.
+     * @param stride Distance between values, in floats.
+     */
+    void FloatHist::add(const float* values, int count, ptrdiff_t stride)
+    {
+        CV_Assert(!counts.empty());
+        cumulativeValid = false;
+
+        BinLookup lookup;
+        lookup.minVal = minVal;
+        lookup.hi = std::max(minVal, maxVal);
+        lookup.offset = (binMode == FloatHistBinMode::Log) ? std::log(minVal) : minVal;
+        lookup.scale = getBinScale();
+        lookup.bins = bins.data();
+        lookup.binCount = (int)counts.size();
+
+        switch (binMode)
+        {
+        case FloatHistBinMode::Uniform:
+            binValues<FloatHistBinMode::Uniform>(values, count, stride, lookup, counts.data());
+            break;
+        case FloatHistBinMode::Log:
+            binValues<FloatHistBinMode::Log>(values, count, stride, lookup, counts.data());
+            break;
+        case FloatHistBinMode::Edges:
+            binValues<FloatHistBinMode::Edges>(values, count, stride, lookup, counts.data());
+            break;
+        }
+    }
+
+    /**
+     * @brief Add all values of a 32F single-channel matrix to the hist, row by row.
+     */
+    void FloatHist::add(const cv::Mat& values)
+    {
+        CV_Assert(values.type() == CV_32F);
+
+        for (int y = 0; y < values.rows; y++)
+        {
+            add(values.ptr<float>(y), values.cols, 1);
+        }
+    }
+
+    bool FloatHist::isSameBinning(const FloatHist& other) const
+    {
+        if ((binMode != other.binMode) || (counts.size() != other.counts.size()) || (minVal != other.minVal) || (maxVal != other.maxVal))
+        {
+            return false;
+        }
+
+        return (binMode != FloatHistBinMode::Edges) || (bins == other.bins);
+    }
+
+    /**
+     * @brief Top of a bin, which is the bottom of the next one or maxVal for the last.
+     */
+    static double findBinTop(const FloatHist& hist, int i)
+    {
+        return (i + 1 < (int)hist.bins.size()) ? hist.bins[i + 1] : hist.maxVal;
+    }
+
+    /**
+     * @brief Add another hist's counts to this one.
+     * If the bins match then counts are just added. Otherwise the other hist is rebinned into this one's bins, assuming
+     * values are spread evenly within each of its bins. Each of its bins is split by overlap and rounded so that the
+     * total count is kept, except for the part of the other range that is outside this one's, which is dropped like
+     * values outside the range are in add(). Any bin modes can be merged.
+     * If this hist is empty it becomes a copy of the other.
+     * @param other
+     */
+    void FloatHist::merge(const FloatHist& other)
+    {
+        if (other.counts.empty())
+        {
+            return;
+        }
+
+        cumulativeValid = false;
+
+        if (counts.empty())
+        {
+            binMode = other.binMode;
+            minVal = other.minVal;
+            maxVal = other.maxVal;
+            bins = other.bins;
+            counts = other.counts;
+            return;
+        }
+
+        int binCount = (int)counts.size();
+
+        if (isSameBinning(other))
+        {
             for (int i = 0; i < binCount; i++)
             {
-                bins[i] = minVal + i * binSize;
-                counts[i] = 0;
+                counts[i] += other.counts[i];
+            }
+
+            return;
+        }
+
+        int otherBinCount = (int)other.counts.size();
+        int i = 0;
+
+        // both bin lists are sorted, so walk them together
+        for (int j = 0; j < otherBinCount; j++)
+        {
+            int count = other.counts[j];
+
+            if (count == 0)
+            {
+                continue;
             }
 
-            // hist
-            for (int i = 0; i < values.size(); i++)
+            double lo = other.bins[j];
+            double hi = findBinTop(other, j);
+
+            // a zero-width bin (single-bin hist of one value) is a point
+            if (hi <= lo)
             {
-                float v = values[i];
+                float v = (float)lo;
+                int weight;
+                BinLookup lookup = { minVal, std::max(minVal, maxVal), minVal, getBinScale(), bins.data(), binCount };
+                int idx = findBin<FloatHistBinMode::Edges>(v, lookup, weight); // bins are valid bottoms in any mode
+                counts[idx] += count * weight;
+                continue;
+            }
 
-                if (!std::isfinite(v))
-                {
-                    counts[binCount - 1]++;
-                }
-                else if ((v >= minVal) && (v <= maxVal))
+            while ((i < binCount) && (findBinTop(*this, i) <= lo))
+            {
+                i++;
+            }
+
+            // split by overlap, rounding the running total so the parts add up to the whole
+            double assignedExact = 0.0;
+            int assigned = 0;
+
+            for (int k = i; (k < binCount) && (bins[k] < hi); k++)
+            {
+                double overlap = std::min(hi, findBinTop(*this, k)) - std::max(lo, (double)bins[k]);
+
+                if (overlap <= 0.0)
                 {
-                    int idx = (int)((values[i] - minVal) / binSize);
-                    idx = std::min(binCount - 1, idx); // if maxVal is == max in array then at least one idx would go over
-                    counts[idx]++;
+                    continue;
                 }
+
+                assignedExact += count * overlap / (hi - lo);
+                int part = (int)std::llround(assignedExact) - assigned;
+                counts[k] += part;
+                assigned += part;
             }
         }
     }
+
+    void FloatHist::invalidateCumulative()
+    {
+        cumulativeValid = false;
+    }
+
+    /**
+     * @brief Running totals of counts, cumulativeCounts[i] is the sum of counts[0] to counts[i].
+     * Computed once and cached until counts change, so many percentile queries on one hist are each a binary search.
+     * The cache is also rebuilt if the size or total of counts no longer matches it, which catches most direct edits of
+     * counts (see counts). Checking the total is a sum over the bins, which is much cheaper than rebuilding.
+     */
+    const std::vector<int64_t>& FloatHist::getCumulativeCounts()
+    {
+        bool isCurrent = cumulativeValid && (cumulativeCounts.size() == counts.size());
+
+        if (isCurrent)
+        {
+            int64_t total = 0;
+
+            for (int c : counts)
+            {
+                total += c;
+            }
+
+            isCurrent = cumulativeCounts.empty() || (cumulativeCounts.back() == total);
+        }
+
+        if (!isCurrent)
+        {
+            cumulativeCounts.resize(counts.size());
+            int64_t total = 0;
+
+            for (size_t i = 0; i < counts.size(); i++)
+            {
+                total += counts[i];
+                cumulativeCounts[i] = total;
+            }
+
+            cumulativeValid = true;
+        }
+
+        return cumulativeCounts;
+    }
+
+    int64_t FloatHist::getTotalCount()
+    {
+        const std::vector<int64_t>& cum = getCumulativeCounts();
+        return cum.empty() ? 0 : cum.back();
+    }
+
+    float FloatHist::getBinTop(int bin)
+    {
+        return (float)findBinTop(*this, bin);
+    }
+
+    /**
+     * @brief Middle of a bin, geometric middle for log bins.
+     */
+    float FloatHist::getBinCenter(int bin)
+    {
+        float top = getBinTop(bin);
+
+        if (binMode == FloatHistBinMode::Log)
+        {
+            return std::sqrt(bins[bin] * top);
+        }
+
+        return 0.5f * (bins[bin] + top);
+    }
+
+    /**
+     * @brief Estimate a percentile from the hist, O(log bins) after the first call (see getCumulativeCounts).
+     * Finds the bin holding the nearest-rank value (sorted index ceil(pct / 100 * n) - 1, like histPercentiles) and
+     * interpolates within the bin, assuming its values are spread evenly.
+     * @param pct 0 to 100.
+     * @return NAN if the hist has no counts.
+     */
+    float FloatHist::getPercentile(float pct)
+    {
+        return getPercentile(getCumulativeCounts(), pct);
+    }
+
+    /**
+     * @brief getPercentile with the running totals already checked, so many percentiles check them once.
+     */
+    float FloatHist::getPercentile(const std::vector<int64_t>& cum, float pct)
+    {
+        int64_t n = cum.empty() ? 0 : cum.back();
+
+        if (n == 0)
+        {
+            return NAN;
+        }
+
+        int64_t rank = std::clamp<int64_t>((int64_t)std::ceil((double)pct / 100.0 * n) - 1, 0, n - 1);
+        int bin = (int)(std::upper_bound(cum.begin(), cum.end(), rank) - cum.begin());
+        int64_t before = (bin > 0) ? cum[bin - 1] : 0;
+        double t = (rank - before + 0.5) / counts[bin];
+        double bottom = bins[bin];
+        double top = findBinTop(*this, bin);
+
+        if ((binMode == FloatHistBinMode::Log) && (bottom > 0.0))
+        {
+            return (float)(bottom * std::pow(top / bottom, t));
+        }
+
+        return (float)(bottom + (top - bottom) * t);
+    }
+
+    void FloatHist::getPercentiles(const std::vector<float>& pcts, std::vector<float>& results)
+    {
+        results.resize(pcts.size());
+        const std::vector<int64_t>& cum = getCumulativeCounts();
+
+        for (size_t i = 0; i < pcts.size(); i++)
+        {
+            results[i] = getPercentile(cum, pcts[i]);
+        }
+    }
+
+    /**
+     * @brief Mean estimated from bin centers and counts, no pass over the data. NAN if the hist has no counts.
+     */
+    double FloatHist::getMean()
+    {
+        int64_t n = getTotalCount();
+
+        if (n == 0)
+        {
+            return NAN;
+        }
+
+        double sum = 0.0;
+
+        for (int i = 0; i < (int)counts.size(); i++)
+        {
+            sum += (double)counts[i] * getBinCenter(i);
+        }
+
+        return sum / n;
+    }
+
+    /**
+     * @brief Population variance estimated from bin centers and counts. This includes the spread from binning, about
+     * binSize^2 / 12 for uniform bins. NAN if the hist has no counts.
+     */
+    double FloatHist::getVariance()
+    {
+        double mean = getMean();
+
+        if (std::isnan(mean))
+        {
+            return NAN;
+        }
+
+        double m2 = 0.0;
+
+        for (int i = 0; i < (int)counts.size(); i++)
+        {
+            double d = getBinCenter(i) - mean;
+            m2 += (double)counts[i] * d * d;
+        }
+
+        return m2 / getTotalCount();
+    }
+
+    /**
+     * @brief Center of the bin with the highest count (the first one if tied). NAN if the hist has no counts.
+     */
+    float FloatHist::getMode()
+    {
+        if (getTotalCount() == 0)
+        {
+            return NAN;
+        }
+
+        int bin = (int)(std::max_element(counts.begin(), counts.end()) - counts.begin());
+        return getBinCenter(bin);
+    }
 }
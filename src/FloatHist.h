@@ -2,16 +2,42 @@
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 #pragma once
 #include <vector>
+#include <span>
+#include <cstdint>
 #include <opencv2/opencv.hpp>
 
 namespace CppOpenCVUtil
 {
     /**
-     * @brief Contains a uniform histogram on floats.
-     * Bin size is computed from minVal, maxVal, and count of bins.
+     * @brief How FloatHist bins are spaced.
+     */
+    enum class FloatHistBinMode
+    {
+        /**
+         * @brief Same size bins from minVal to maxVal.
+         */
+        Uniform,
+
+        /**
+         * @brief Bins the same size in log(value), from minVal (gt 0) to maxVal.
+         */
+        Log,
+
+        /**
+         * @brief Arbitrary increasing bin edges, bins holds the bottoms and maxVal is the top of the last.
+         */
+        Edges
+    };
+
+    /**
+     * @brief Contains a histogram on floats.
+     * Bins are uniform by default, with bin size computed from minVal, maxVal, and count of bins. They can also be
+     * log-spaced or have arbitrary edges, see binMode.
      */
     struct FloatHist
     {
+        FloatHistBinMode binMode = FloatHistBinMode::Uniform;
+
         /**
          * @brief Bottom of the first bin.
          */
@@ -30,6 +56,8 @@ namespace CppOpenCVUtil
 
         /**
          * @brief Counts per bin.
+         * Code that changes these directly should call invalidateCumulative(). A change of size or total is detected
+         * anyway, but one that moves counts between bins is not.
          */
         std::vector<int> counts;
 
@@ -41,6 +69,49 @@ namespace CppOpenCVUtil
         float getMax();
         void copy(FloatHist& other);
 
+        float getBinScale();
+
         void compute(const std::vector<float>& values, int binCount, float minVal = NAN, float maxVal = NAN);
+        void compute(std::span<const float> values, int binCount, float minVal = NAN, float maxVal = NAN);
+        void compute(const float* values, int count, ptrdiff_t stride, int binCount, float minVal = NAN, float maxVal = NAN);
+        void compute(const cv::Mat& values, int binCount, float minVal = NAN, float maxVal = NAN);
+
+        /**
+         * @brief Set up empty uniform bins from minVal to maxVal, for filling with add().
+         */
+        void init(int binCount, float minVal, float maxVal);
+        void initLog(int binCount, float minVal, float maxVal);
+        void initEdges(std::span<const float> edges);
+
+        void add(float value);
+        void add(const std::vector<float>& values);
+        void add(std::span<const float> values);
+        void add(const float* values, int count, ptrdiff_t stride);
+        void add(const cv::Mat& values);
+
+        bool isSameBinning(const FloatHist& other) const;
+        void merge(const FloatHist& other);
+
+        void invalidateCumulative();
+        const std::vector<int64_t>& getCumulativeCounts();
+        int64_t getTotalCount();
+        float getBinTop(int bin);
+        float getBinCenter(int bin);
+
+        float getPercentile(float pct);
+        void getPercentiles(const std::vector<float>& pcts, std::vector<float>& results);
+        double getMean();
+        double getVariance();
+        float getMode();
+
+    private:
+        /**
+         * @brief Cache of running totals of counts, see getCumulativeCounts().
+         * Everything in FloatHist that changes counts invalidates this.
+         */
+        mutable std::vector<int64_t> cumulativeCounts;
+        mutable bool cumulativeValid = false;
+
+        float getPercentile(const std::vector<int64_t>& cum, float pct);
     };
 }
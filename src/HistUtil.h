@@ -0,0 +1,124 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//
+// Internal helpers shared by the histogram and percentile code (ImageHist.cpp, StreamStats.cpp), not part of the public API.
+//
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Find several nearest-rank percentiles in a histogram with one cumulative scan.
+         * The percentile is the bin holding sorted index ceil(pct / 100 * n) - 1, so 0 is the lowest nonempty bin
+         * and 100 is the highest.
+         * @param counts Counts per bin, int or int64_t.
+         * @param binCount
+         * @param n Total of counts, must be gt 0.
+         * @param pcts Percentiles to find, 0 to 100, any order.
+         * @param pctCount
+         * @param binIdxs Output, bin index per percentile.
+         * @param ranksInBin Optional output, the target rank's offset within its bin per percentile.
+         */
+        template <typename C>
+        void findPercentilesInHist(const C* counts, int binCount, int64_t n, const float* pcts, int pctCount, int* binIdxs, int64_t* ranksInBin = nullptr)
+        {
+            static thread_local std::vector<int64_t> ranks;
+            static thread_local std::vector<int> order;
+            ranks.resize(pctCount);
+            order.resize(pctCount);
+
+            for (int i = 0; i < pctCount; i++)
+            {
+                int64_t k = (int64_t)std::ceil((double)pcts[i] / 100.0 * n) - 1;
+                ranks[i] = std::clamp<int64_t>(k, 0, n - 1);
+                order[i] = i;
+            }
+
+            // scan once in rank order
+            std::sort(order.begin(), order.end(), [&](int a, int b) { return ranks[a] < ranks[b]; });
+            int64_t cumBefore = 0;
+            int b = 0;
+
+            for (int i : order)
+            {
+                while ((b < binCount - 1) && (cumBefore + counts[b] <= ranks[i]))
+                {
+                    cumBefore += counts[b];
+                    b++;
+                }
+
+                binIdxs[i] = b;
+
+                if (ranksInBin)
+                {
+                    ranksInBin[i] = ranks[i] - cumBefore;
+                }
+            }
+        }
+
+        /**
+         * @brief Map a value to a uint32 key with the same ordering.
+         * For float the negatives are flipped, for int the sign bit is flipped.
+         */
+        inline uint32_t toOrderedKey(float v)
+        {
+            uint32_t u;
+            memcpy(&u, &v, sizeof(u));
+            return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+        }
+
+        inline uint32_t toOrderedKey(int32_t v)
+        {
+            return (uint32_t)v ^ 0x80000000u;
+        }
+
+        template <typename T>
+        T fromOrderedKey(uint32_t key);
+
+        template <>
+        inline float fromOrderedKey<float>(uint32_t key)
+        {
+            uint32_t u = (key & 0x80000000u) ? (key ^ 0x80000000u) : ~key;
+            float v;
+            memcpy(&v, &u, sizeof(v));
+            return v;
+        }
+
+        template <>
+        inline int32_t fromOrderedKey<int32_t>(uint32_t key)
+        {
+            return (int32_t)(key ^ 0x80000000u);
+        }
+
+        /**
+         * @brief Relative error of a percentile taken from just the first (top 16 bits) level of the radix select.
+         * The top 16 bits of the key are sign, exponent and 7 bits of mantissa.
+         */
+        const float Percentile32fCoarseRelError = 1.0f / 128.0f;
+
+        /**
+         * @brief Top 16 bits of the ordered key of each value, by value type, as a histogram. In ImageHist.cpp.
+         */
+        void histTopKey16(const cv::Mat& img, std::vector<int>& counts, const cv::Mat& mask = cv::Mat());
+
+        /**
+         * @brief The value at the magnitude-floor edge of a top-16-bit key bin, i.e. the bin edge closest to zero.
+         * For 32F this is always finite or exactly +-inf and is within Percentile32fCoarseRelError of any value in the bin.
+         */
+        template <typename T>
+        T topKeyBinEdge(int bin)
+        {
+            uint32_t key = (uint32_t)bin << 16;
+            return fromOrderedKey<T>((key & 0x80000000u) ? key : (key | 0xFFFFu));
+        }
+    }
+}
@@ -0,0 +1,747 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#include <string>
+#include <cstring>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+#include "MiscUtil.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+using namespace CppBaseUtil;
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Pixel positions of everything in a collage, computed once from the spec and the first image.
+         * The collage is a top margin and then one band per row of tiles. Each band is the tiles, the caption area under
+         * them, and the margin under that.
+         */
+        struct CollageLayout
+        {
+            int width = 0;
+            int height = 0;
+            int colCount = 0;
+            int rowCount = 0;
+            int marginPx = 0;
+            int tileWidth = 0;
+            int tileHeight = 0;
+            int captionMargin = 0;
+
+            /**
+             * @brief Height of the caption area under each row of tiles (0 without captions).
+             */
+            int textAreaHeight = 0;
+
+            /**
+             * @brief Distance from one row of tiles to the next.
+             */
+            int rowPitch() const
+            {
+                return tileHeight + textAreaHeight + marginPx;
+            }
+
+            cv::Rect getTileRect(int i) const
+            {
+                int row = i / colCount;
+                int col = i % colCount;
+                return cv::Rect(marginPx + col * (tileWidth + marginPx), marginPx + row * rowPitch(), tileWidth, tileHeight);
+            }
+
+            /**
+             * @brief Rows that a row's captions may draw into, from the bottom of the tiles to the top of the next row's tiles
+             * (or the bottom of the collage).
+             */
+            cv::Range getCaptionRows(int row) const
+            {
+                int top = marginPx + row * rowPitch() + tileHeight;
+                return cv::Range(top, std::min(height, top + textAreaHeight + marginPx));
+            }
+
+            /**
+             * @brief Collage rows covered by tile rows row0 to row1 (exclusive), from the top of row0's tiles (or the top of
+             * the collage for row 0) down to the top of row1's tiles (or the bottom of the collage).
+             * Consecutive ranges of tile rows give consecutive bands that cover the whole collage.
+             */
+            cv::Range getBandRows(int row0, int row1) const
+            {
+                int top = (row0 == 0) ? 0 : marginPx + row0 * rowPitch();
+                return cv::Range(top, marginPx + row1 * rowPitch());
+            }
+        };
+
+        static CollageLayout getCollageLayout(const CollageSpec& spec, int imgCount, cv::Size firstImgSize)
+        {
+            CollageLayout layout;
+
+            // setup for text
+            int baseline;
+            int exampleTextHeight = cv::getTextSize(std::string("Foo1"), spec.fontFace, spec.fontScale, 1, &baseline).height;
+            layout.captionMargin = exampleTextHeight / 2;
+
+            if (!spec.doCaptions)
+            {
+                exampleTextHeight = 0;
+                layout.captionMargin = 0;
+            }
+
+            // assume all images same aspect ratio
+            int totalMarginCol = (spec.colCount + 1) * spec.marginPx;
+            double imgScale = ((double)spec.imageWidthPx - totalMarginCol) / (spec.colCount * firstImgSize.width);
+
+            layout.width = spec.imageWidthPx;
+            layout.colCount = spec.colCount;
+            layout.rowCount = (imgCount + spec.colCount - 1) / spec.colCount;
+            layout.marginPx = spec.marginPx;
+            layout.tileWidth = (spec.imageWidthPx - totalMarginCol) / spec.colCount;
+            layout.tileHeight = (int)(imgScale * firstImgSize.height);
+            layout.textAreaHeight = 2 * layout.captionMargin + exampleTextHeight;
+            layout.height = spec.marginPx + layout.rowCount * layout.rowPitch();
+
+            return layout;
+        }
+
+        /**
+         * @brief Scale one image into its tile, a sub-view of the collage, without allocating.
+         * 8UC3 is resized straight into the tile (OpenCV writes into an output that already has the right size and type).
+         * 8UC1 is resized into a per-thread single-channel buffer, a third of the tile and still in cache, and expanded to
+         * RGB straight into the tile. A hand-written fused kernel would not match cv::resize bit for bit.
+         * An 8UC1 image that is already the tile size skips the buffer (cv::resize itself just copies when the size matches).
+         */
+        static void renderTile(const cv::Mat& img, cv::Mat tileDst)
+        {
+            if (img.type() == CV_8UC3)
+            {
+                cv::resize(img, tileDst, tileDst.size());
+            }
+            else if (img.type() == CV_8UC1)
+            {
+                if (img.size() == tileDst.size())
+                {
+                    cv::cvtColor(img, tileDst, cv::COLOR_GRAY2RGB);
+                }
+                else
+                {
+                    static thread_local cv::Mat scaled;
+                    cv::resize(img, scaled, tileDst.size());
+                    cv::cvtColor(scaled, tileDst, cv::COLOR_GRAY2RGB);
+                }
+            }
+            else
+            {
+                bail("renderCollage: Images must be 8UC1 or 8UC3");
+            }
+        }
+
+        /**
+         * @brief Approximate advance (width added) of each byte value when drawn in one font, from getTextSize.
+         */
+        struct GlyphAdvances
+        {
+            int fontFace = 0;
+            double fontScale = 0.0;
+            int thickness = 0;
+            std::array<double, 256> advances = {};
+        };
+
+        /**
+         * @brief Glyph advances for a font, measured once per thread and font and then cached.
+         * Each advance is measured over a run of the character so that getTextSize's rounding is spread over the run.
+         */
+        static const GlyphAdvances& getGlyphAdvances(int fontFace, double fontScale, int thickness)
+        {
+            static thread_local std::vector<GlyphAdvances> cache;
+
+            for (const GlyphAdvances& g : cache)
+            {
+                if ((g.fontFace == fontFace) && (g.fontScale == fontScale) && (g.thickness == thickness))
+                {
+                    return g;
+                }
+            }
+
+            const int runLength = 32;
+            GlyphAdvances g;
+            g.fontFace = fontFace;
+            g.fontScale = fontScale;
+            g.thickness = thickness;
+            int baseline;
+
+            for (int c = 1; c < 256; c++)
+            {
+                int w1 = cv::getTextSize(std::string(1, (char)c), fontFace, fontScale, thickness, &baseline).width;
+                int wn = cv::getTextSize(std::string(runLength + 1, (char)c), fontFace, fontScale, thickness, &baseline).width;
+                g.advances[c] = (double)(wn - w1) / runLength;
+            }
+
+            cache.push_back(g);
+            return cache.back();
+        }
+
+        /**
+         * @brief Shorten text to fit a width, keeping the longest prefix that fits, optionally followed by "...".
+         * Text widths come from cv::getTextSize so the result matches what putText draws. Instead of measuring once per
+         * removed character, the fit length is estimated from cached per-glyph advances and then confirmed by a binary search
+         * over prefix widths, which starts bracketed around the estimate so it usually takes two or three measurements.
+         * @param text
+         * @param maxWidth Widest allowed, in pixels.
+         * @param fontFace OpenCV font face.
+         * @param fontScale
+         * @param thickness
+         * @param doEllipsis If true and text has to be shortened then "..." is appended (and fits within maxWidth too).
+         * @param textSize Optional output, the size of the returned text from getTextSize.
+         * @return text if it fits, else the shortened text. Empty if not even "..." (or anything) fits.
+         */
+        std::string fitTextToWidth(const std::string& text, int maxWidth, int fontFace, double fontScale, int thickness, bool doEllipsis, cv::Size* textSize)
+        {
+            int baseline;
+            cv::Size size = cv::getTextSize(text, fontFace, fontScale, thickness, &baseline);
+
+            if (size.width <= maxWidth)
+            {
+                if (textSize != nullptr)
+                {
+                    *textSize = size;
+                }
+
+                return text;
+            }
+
+            const std::string suffix = doEllipsis ? "..." : "";
+            int n = (int)text.size();
+
+            auto fits = [&](int len)
+            {
+                return cv::getTextSize(text.substr(0, len) + suffix, fontFace, fontScale, thickness, &baseline).width <= maxWidth;
+            };
+
+            // estimate from the cached advances
+            const GlyphAdvances& glyphs = getGlyphAdvances(fontFace, fontScale, thickness);
+            double budget = maxWidth - thickness;
+            double width = 0.0;
+            int estimate = 0;
+
+            for (char c : suffix)
+            {
+                budget -= glyphs.advances[(uint8_t)c];
+            }
+
+            while ((estimate < n - 1) && (width + glyphs.advances[(uint8_t)text[estimate]] <= budget))
+            {
+                width += glyphs.advances[(uint8_t)text[estimate]];
+                estimate++;
+            }
+
+            // binary search for the longest prefix that fits, lo fits (or is 0) and hi does not (the full text does not)
+            int lo = 0;
+            int hi = n;
+
+            if (fits(estimate))
+            {
+                lo = estimate;
+
+                if (estimate + 1 < hi)
+                {
+                    if (fits(estimate + 1))
+                    {
+                        lo = estimate + 1;
+                    }
+                    else
+                    {
+                        hi = estimate + 1;
+                    }
+                }
+            }
+            else
+            {
+                hi = estimate;
+            }
+
+            while (hi - lo > 1)
+            {
+                int mid = (lo + hi) / 2;
+
+                if (fits(mid))
+                {
+                    lo = mid;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+
+            std::string result = ((lo > 0) || fits(0)) ? text.substr(0, lo) + suffix : std::string();
+
+            if (textSize != nullptr)
+            {
+                *textSize = cv::getTextSize(result, fontFace, fontScale, thickness, &baseline);
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Draw the captions for one row of tiles, clipped to the rows under those tiles.
+         * Clipping means a caption can never touch a tile, which is what lets captions be drawn after (and in parallel with
+         * other rows of) the tiles and still give the same pixels as drawing each caption right after its tile.
+         */
+        static void renderRowCaptions(const std::vector<std::string>& captions, const CollageSpec& spec, const CollageLayout& layout, int row, cv::Mat& band, int bandY)
+        {
+            cv::Scalar captionColor = spec.doBlackBackground ? cv::Scalar(255, 255, 255) : cv::Scalar(0, 0, 0);
+            cv::Range clipRows = layout.getCaptionRows(row);
+            cv::Mat clipDst = band.rowRange(clipRows.start - bandY, clipRows.end - bandY);
+            int i0 = row * layout.colCount;
+            int i1 = std::min((int)captions.size(), i0 + layout.colCount);
+
+            for (int i = i0; i < i1; i++)
+            {
+                if (captions[i].empty())
+                {
+                    continue;
+                }
+
+                // strictly narrower than the tile
+                cv::Rect roi = layout.getTileRect(i);
+                cv::Size textSize;
+                std::string s = fitTextToWidth(captions[i], layout.tileWidth - 1, spec.fontFace, spec.fontScale, 1, spec.doCaptionEllipsis, &textSize);
+
+                cv::Point textOrg(roi.x + (roi.width - textSize.width) / 2, roi.y + roi.height + textSize.height + layout.captionMargin - clipRows.start);
+                cv::putText(clipDst, s, textOrg, spec.fontFace, spec.fontScale, captionColor, 1, cv::LINE_AA);
+            }
+        }
+
+        /**
+         * @brief Image i of a collage, which may be loaded on demand. Called from several threads at once.
+         */
+        using CollageImageSource = std::function<cv::Mat(int i)>;
+
+        /**
+         * @brief Render tile rows row0 to row1 (exclusive) of a collage into band, which is getBandRows(row0, row1) of the
+         * collage.
+         * Tiles are rendered by workerCount parallel workers that each take the next tile until there are none left. Each
+         * gets its image from getImage, scales it into its own sub-view of band, and drops it, so at most workerCount images
+         * are held at once. Then captions are drawn in a second phase, parallel over rows of tiles. Tiles and caption areas
+         * don't overlap, so the output is the same for any number of threads.
+         */
+        static void renderCollageRows(int imgCount, const CollageImageSource& getImage, const std::vector<std::string>& captions,
+            const CollageSpec& spec, const CollageLayout& layout, int row0, int row1, int workerCount, cv::Mat& band)
+        {
+            int bandY = layout.getBandRows(row0, row1).start;
+            int i1 = std::min(imgCount, row1 * layout.colCount);
+            std::atomic<int> nextTile(row0 * layout.colCount);
+
+            band.setTo(spec.doBlackBackground ? cv::Scalar(0, 0, 0) : cv::Scalar(255, 255, 255));
+
+            // tiles, each writes only its own roi
+            cv::parallel_for_(cv::Range(0, workerCount), [&](const cv::Range& range)
+            {
+                for (int w = range.start; w < range.end; w++)
+                {
+                    for (int i = nextTile++; i < i1; i = nextTile++)
+                    {
+                        cv::Rect roi = layout.getTileRect(i);
+                        roi.y -= bandY;
+                        renderTile(getImage(i), band(roi));
+                    }
+                }
+            }, workerCount);
+
+            // captions, each row writes only the rows under its tiles
+            if (spec.doCaptions && !captions.empty())
+            {
+                cv::parallel_for_(cv::Range(row0, row1), [&](const cv::Range& range)
+                {
+                    for (int row = range.start; row < range.end; row++)
+                    {
+                        renderRowCaptions(captions, spec, layout, row, band, bandY);
+                    }
+                });
+            }
+        }
+
+        static int getCollageWorkerCount(int maxDecodeThreads)
+        {
+            return (maxDecodeThreads > 0) ? maxDecodeThreads : std::max(1, cv::getNumThreads());
+        }
+
+        /**
+         * @brief Render a whole collage, or band by band to sink if sink is set.
+         * @param firstImg Image 0, already loaded to get the layout. It is released once its tile is rendered.
+         */
+        static void renderCollageFromSource(int imgCount, const CollageImageSource& getImage, cv::Mat firstImg, const std::vector<std::string>& captions,
+            const CollageSpec& spec, int workerCount, const CollageBandSink* sink, int tileRowsPerBand, cv::Mat& dst)
+        {
+            CollageLayout layout = getCollageLayout(spec, imgCount, firstImg.size());
+            std::atomic<bool> isFirstTaken(false);
+
+            auto getImageReusingFirst = [&](int i)
+            {
+                if ((i == 0) && !isFirstTaken.exchange(true))
+                {
+                    cv::Mat img = firstImg;
+                    firstImg.release();
+                    return img;
+                }
+
+                return getImage(i);
+            };
+
+            if (sink == nullptr)
+            {
+                dst.create(layout.height, layout.width, CV_8UC3);
+                renderCollageRows(imgCount, getImageReusingFirst, captions, spec, layout, 0, layout.rowCount, workerCount, dst);
+                return;
+            }
+
+            for (int row0 = 0; row0 < layout.rowCount; row0 += tileRowsPerBand)
+            {
+                int row1 = std::min(layout.rowCount, row0 + tileRowsPerBand);
+                cv::Range bandRows = layout.getBandRows(row0, row1);
+                dst.create(bandRows.size(), layout.width, CV_8UC3);
+                renderCollageRows(imgCount, getImageReusingFirst, captions, spec, layout, row0, row1, workerCount, dst);
+                (*sink)(dst, bandRows.start);
+            }
+        }
+
+        /**
+         * @brief Size of the collage that renderCollage would make, without rendering it.
+         * @param imgCount
+         * @param firstImgSize Size of the first image, which sets the aspect ratio of every tile.
+         * @param spec
+         */
+        cv::Size getCollageSize(int imgCount, cv::Size firstImgSize, const CollageSpec& spec)
+        {
+            if (imgCount <= 0)
+            {
+                return cv::Size();
+            }
+
+            CollageLayout layout = getCollageLayout(spec, imgCount, firstImgSize);
+            return cv::Size(layout.width, layout.height);
+        }
+
+        /**
+         * @brief Render the list of images into a single output image (dst) in a grid of rows and colums, per the spec.
+         * Partially by ChatGPT-4.
+         * Tiles are rendered in parallel, each straight into its part of dst, then captions in a second phase, see
+         * renderCollageBands to render a band at a time for collages too big to hold.
+         * @param images The images to render. They must all be 8UC1 or 8UC3. These will all be rendered to the aspect ratio of the first image.
+         * @param captions A caption for each image (empty vector or strings for no caption).
+         * @param spec Parameters for how to render.
+         * @param dst Output image.
+         */
+        void renderCollage(const std::vector<cv::Mat>& images, const std::vector<std::string>& captions, const CollageSpec& spec, cv::Mat& dst)
+        {
+            if (images.empty())
+            {
+                return;
+            }
+
+            auto getImage = [&](int i) { return images[i]; };
+            renderCollageFromSource((int)images.size(), getImage, images[0], captions, spec, getCollageWorkerCount(0), nullptr, 0, dst);
+        }
+
+        /**
+         * @brief Render a collage like renderCollage, but a band of tile rows at a time, handing each band to sink instead
+         * of building the whole collage. Peak memory is one band, which is reused.
+         * The bands are in order and together they are exactly the image renderCollage makes. Use getCollageSize for
+         * the total size up front, e.g. to open a StripWriter.
+         * @param images The images to render, see renderCollage.
+         * @param captions A caption for each image (empty vector or strings for no caption).
+         * @param spec Parameters for how to render.
+         * @param sink Called with each band (8UC3, valid only during the call) and the collage row of its top.
+         * @param tileRowsPerBand Rows of tiles per band. More rows means more tiles to render in parallel per band.
+         */
+        void renderCollageBands(const std::vector<cv::Mat>& images, const std::vector<std::string>& captions, const CollageSpec& spec,
+            const CollageBandSink& sink, int tileRowsPerBand)
+        {
+            CV_Assert(tileRowsPerBand > 0);
+
+            if (images.empty())
+            {
+                return;
+            }
+
+            cv::Mat band;
+            auto getImage = [&](int i) { return images[i]; };
+            renderCollageFromSource((int)images.size(), getImage, images[0], captions, spec, getCollageWorkerCount(0), &sink, tileRowsPerBand, band);
+        }
+
+        /**
+         * @brief Render a collage of images that are loaded on demand instead of all held up front, see renderCollage.
+         * Images are loaded and rendered by at most maxDecodeThreads workers, and each image is dropped as soon as its tile
+         * is rendered, so at most that many images are held at once. Image 0 is loaded first at full size, for the layout.
+         * @param imgCount
+         * @param loader Returns image i (8UC1 or 8UC3), called from several threads at once. tileSize is what the image will
+         *     be scaled to, so a loader can decode at reduced resolution, and is empty for image 0.
+         * @param captions A caption for each image (empty vector or strings for no caption).
+         * @param spec Parameters for how to render.
+         * @param dst Output image.
+         * @param maxDecodeThreads Most images loading at once, 0 for the OpenCV thread count.
+         */
+        void renderCollage(int imgCount, const CollageImageLoader& loader, const std::vector<std::string>& captions, const CollageSpec& spec,
+            cv::Mat& dst, int maxDecodeThreads)
+        {
+            if (imgCount <= 0)
+            {
+                return;
+            }
+
+            cv::Mat firstImg = loader(0, cv::Size());
+            CollageLayout layout = getCollageLayout(spec, imgCount, firstImg.size());
+            cv::Size tileSize(layout.tileWidth, layout.tileHeight);
+            auto getImage = [&](int i) { return loader(i, tileSize); };
+            renderCollageFromSource(imgCount, getImage, firstImg, captions, spec, getCollageWorkerCount(maxDecodeThreads), nullptr, 0, dst);
+        }
+
+        /**
+         * @brief Render a collage of images loaded on demand, a band at a time, combining renderCollage with a loader and
+         * renderCollageBands. Peak memory is one band plus at most maxDecodeThreads images.
+         */
+        void renderCollageBands(int imgCount, const CollageImageLoader& loader, const std::vector<std::string>& captions, const CollageSpec& spec,
+            const CollageBandSink& sink, int tileRowsPerBand, int maxDecodeThreads)
+        {
+            CV_Assert(tileRowsPerBand > 0);
+
+            if (imgCount <= 0)
+            {
+                return;
+            }
+
+            cv::Mat band;
+            cv::Mat firstImg = loader(0, cv::Size());
+            CollageLayout layout = getCollageLayout(spec, imgCount, firstImg.size());
+            cv::Size tileSize(layout.tileWidth, layout.tileHeight);
+            auto getImage = [&](int i) { return loader(i, tileSize); };
+            renderCollageFromSource(imgCount, getImage, firstImg, captions, spec, getCollageWorkerCount(maxDecodeThreads), &sink, tileRowsPerBand, band);
+        }
+
+        /**
+         * @brief EXIF orientation (1 to 8) from the body of an APP1 segment, or 0 if it isn't EXIF or has no orientation tag.
+         */
+        static int readExifOrientation(const std::vector<uint8_t>& seg)
+        {
+            // "Exif\0\0" then a TIFF header and IFD0
+            const size_t tiffStart = 6;
+
+            if ((seg.size() < tiffStart + 8) || (memcmp(seg.data(), "Exif\0\0", 6) != 0))
+            {
+                return 0;
+            }
+
+            const uint8_t* tiff = seg.data() + tiffStart;
+            size_t tiffSize = seg.size() - tiffStart;
+            bool bigEndian = (tiff[0] == 'M');
+
+            auto get = [&](size_t offset, int size) -> uint32_t
+            {
+                uint32_t val = 0;
+
+                for (int i = 0; i < size; i++)
+                {
+                    int shift = bigEndian ? (size - 1 - i) * 8 : i * 8;
+                    val |= (uint32_t)tiff[offset + i] << shift;
+                }
+
+                return val;
+            };
+
+            size_t ifdOffset = get(4, 4);
+
+            if (ifdOffset + 2 > tiffSize)
+            {
+                return 0;
+            }
+
+            int entryCount = (int)get(ifdOffset, 2);
+
+            for (int i = 0; i < entryCount; i++)
+            {
+                size_t entryOffset = ifdOffset + 2 + (size_t)i * 12;
+
+                if (entryOffset + 12 > tiffSize)
+                {
+                    break;
+                }
+
+                // a single SHORT, left-justified in the value field
+                if (get(entryOffset, 2) == 0x0112)
+                {
+                    int orientation = (int)get(entryOffset + 8, 2);
+                    return ((orientation >= 1) && (orientation <= 8)) ? orientation : 0;
+                }
+            }
+
+            return 0;
+        }
+
+        /**
+         * @brief Width and height of a JPEG from its frame header, without decoding it, as imread returns it.
+         * imread applies the EXIF orientation, which for orientations 5 to 8 swaps width and height.
+         * @return false if the header could not be found.
+         */
+        static bool readJpegSize(const std::string& path, cv::Size& size)
+        {
+            std::ifstream file(path, std::ios::binary);
+            uint8_t buf[9];
+            int orientation = 1;
+
+            if (!file.read((char*)buf, 2) || (buf[0] != 0xFF) || (buf[1] != 0xD8))
+            {
+                return false;
+            }
+
+            while (file.read((char*)buf, 2))
+            {
+                if (buf[0] != 0xFF)
+                {
+                    return false;
+                }
+
+                int marker = buf[1];
+
+                // fill bytes, and markers without a length
+                if ((marker == 0xFF) || (marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD7)))
+                {
+                    if (marker == 0xFF)
+                    {
+                        file.seekg(-1, std::ios::cur);
+                    }
+
+                    continue;
+                }
+
+                // start of scan or end of image before a frame header
+                if ((marker == 0xDA) || (marker == 0xD9) || !file.read((char*)buf, 2))
+                {
+                    return false;
+                }
+
+                int length = (buf[0] << 8) | buf[1];
+                bool isFrameHeader = (marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC);
+
+                if (isFrameHeader)
+                {
+                    if (!file.read((char*)buf, 5))
+                    {
+                        return false;
+                    }
+
+                    size = cv::Size((buf[3] << 8) | buf[4], (buf[1] << 8) | buf[2]);
+
+                    if (orientation >= 5)
+                    {
+                        // transposed or rotated 90 degrees
+                        std::swap(size.width, size.height);
+                    }
+
+                    return (size.width > 0) && (size.height > 0);
+                }
+
+                if ((marker == 0xE1) && (length > 2))
+                {
+                    // APP1, which holds EXIF
+                    std::vector<uint8_t> seg(length - 2);
+
+                    if (!file.read((char*)seg.data(), seg.size()))
+                    {
+                        return false;
+                    }
+
+                    int exifOrientation = readExifOrientation(seg);
+
+                    if (exifOrientation > 0)
+                    {
+                        orientation = exifOrientation;
+                    }
+
+                    continue;
+                }
+
+                file.seekg(length - 2, std::ios::cur);
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Load an image for a collage tile, as 8UC3.
+         * A JPEG at least twice the tile size in both dimensions is decoded at 1/2, 1/4 or 1/8 size (IMREAD_REDUCED_*),
+         * the most reduction that is still no smaller than the tile, which is much faster and smaller than a full decode.
+         * Sizes are compared after the EXIF orientation that imread applies. Other formats are decoded at full size.
+         * @param path
+         * @param tileSize Size the image will be scaled to. Empty for a full-size decode.
+         * @return The image. Throws if it could not be read.
+         */
+        cv::Mat loadCollageImage(const std::string& path, cv::Size tileSize)
+        {
+            int flags = cv::IMREAD_COLOR;
+            std::string ext = getNormalizedExt(fs::path(path).extension().string());
+            cv::Size fullSize;
+
+            if (!tileSize.empty() && ((ext == "jpg") || (ext == "jpeg") || (ext == "jpe")) && readJpegSize(path, fullSize))
+            {
+                const int reducedFlags[] = { cv::IMREAD_REDUCED_COLOR_8, cv::IMREAD_REDUCED_COLOR_4, cv::IMREAD_REDUCED_COLOR_2 };
+                int factor = 8;
+
+                for (int reducedFlag : reducedFlags)
+                {
+                    if ((fullSize.width / factor >= tileSize.width) && (fullSize.height / factor >= tileSize.height))
+                    {
+                        flags = reducedFlag;
+                        break;
+                    }
+
+                    factor /= 2;
+                }
+            }
+
+            cv::Mat img = cv::imread(path, flags);
+
+            if (img.empty())
+            {
+                bail("renderCollage: Could not read image " + path);
+            }
+
+            return img;
+        }
+
+        /**
+         * @brief A collage loader for image files, see loadCollageImage.
+         * @param paths Must outlive the loader.
+         */
+        CollageImageLoader getCollageFileLoader(const std::vector<std::string>& paths)
+        {
+            return [&paths](int i, cv::Size tileSize)
+            {
+                return loadCollageImage(paths[i], tileSize);
+            };
+        }
+
+        /**
+         * @brief Render a collage of image files, loading them on demand (see the loader overload and loadCollageImage)
+         * instead of all up front.
+         * @param paths Image files.
+         * @param captions A caption for each image (empty vector or strings for no caption).
+         * @param spec Parameters for how to render.
+         * @param dst Output image.
+         * @param maxDecodeThreads Most images loading at once, 0 for the OpenCV thread count.
+         */
+        void renderCollage(const std::vector<std::string>& paths, const std::vector<std::string>& captions, const CollageSpec& spec, cv::Mat& dst,
+            int maxDecodeThreads)
+        {
+            renderCollage((int)paths.size(), getCollageFileLoader(paths), captions, spec, dst, maxDecodeThreads);
+        }
+    }
+}
@@ -0,0 +1,1340 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+#include "ParallelUtil.h"
+#include "HistUtil.h"
+#include "MiscUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Bin index for an integer value: (v - offset) >> binShift, done in unsigned so that
+         * 32S ranges wider than INT_MAX do not overflow. For 8U and 16U offset is 0 and this is just the shift.
+         * The shift is 64-bit so that binShift 32 (the full 32S range in one bin) is defined.
+         */
+        template <typename T>
+        static inline uint32_t toHistBin(T v, int32_t offset, int binShift)
+        {
+            return (uint32_t)((uint64_t)((uint32_t)(int32_t)v - (uint32_t)offset) >> binShift);
+        }
+
+        /**
+         * @brief Load 8 mask bytes as one word, for testing 8 pixels of an 8U mask at once.
+         */
+        static inline uint64_t loadMask8(const uint8_t* m)
+        {
+            uint64_t v;
+            memcpy(&v, m, sizeof(v));
+            return v;
+        }
+
+        /**
+         * @brief True if all 8 bytes of a loaded mask word are nonzero.
+         * For each byte the high bit of (b & 0x7F) + 0x7F is set if any low bit is set, and there are no carries between bytes.
+         */
+        static inline bool isMask8AllSet(uint64_t v)
+        {
+            const uint64_t low7 = 0x7F7F7F7F7F7F7F7Full;
+            const uint64_t high = 0x8080808080808080ull;
+            return ((v | ((v & low7) + low7)) & high) == high;
+        }
+
+        /**
+         * @brief Call fn(x) for each x in 0 to cols where the 8U mask row is nonzero.
+         * Runs of 8 masked-out pixels are skipped with a single test, which is most of the row outside a segmentation mask.
+         */
+        template <typename Fn>
+        static inline void forEachUnmasked(const uint8_t* m, int cols, Fn&& fn)
+        {
+            int x = 0;
+
+            for (; x + 8 <= cols; x += 8)
+            {
+                if (loadMask8(m + x) == 0)
+                {
+                    continue;
+                }
+
+                for (int k = 0; k < 8; k++)
+                {
+                    if (m[x + k])
+                    {
+                        fn(x + k);
+                    }
+                }
+            }
+
+            for (; x < cols; x++)
+            {
+                if (m[x])
+                {
+                    fn(x);
+                }
+            }
+        }
+
+        /**
+         * @brief Check that a mask is empty or an 8U mask the same size as img.
+         */
+        static void checkHistMask(const cv::Mat& img, const cv::Mat& mask)
+        {
+            if (!mask.empty())
+            {
+                CV_Assert(mask.type() == CV_8U && mask.rows == img.rows && mask.cols == img.cols);
+            }
+        }
+
+        /**
+         * @brief Histogram a stripe of rows into counterCount interleaved sub-histograms.
+         * Consecutive pixels go to different sub-histograms so that runs of equal values do not serialize on
+         * the same counter (store-to-load forwarding stalls).
+         * With a mask the row is taken 8 pixels at a time: all masked out is skipped, all set is counted like the unmasked
+         * case, and a mixed block counts just its set pixels. A masked-out pixel is never binned, since with a range fit to
+         * the masked pixels (histIntAdaptive) its bin can be outside the histogram.
+         * @param offset Subtracted from each value before binning, so that signed values start at bin 0.
+         * @param sub counterCount * binCount ints, zeroed.
+         */
+        template <typename T, int CounterCount, bool HasMask>
+        static void histIntRows(const cv::Mat& img, const cv::Mat& mask, int r0, int r1, int32_t offset, int binShift, int binCount, int* sub)
+        {
+            int* h0 = sub;
+            int* h1 = sub + (CounterCount > 1 ? binCount : 0);
+            int* h2 = sub + (CounterCount > 2 ? 2 * binCount : 0);
+            int* h3 = sub + (CounterCount > 3 ? 3 * binCount : 0);
+            int* hs[4] = { h0, h1, h2, h3 };
+            int cols = img.cols;
+
+            for (int y = r0; y < r1; y++)
+            {
+                const T* ps = img.ptr<T>(y);
+                int x = 0;
+
+                if constexpr (HasMask)
+                {
+                    const uint8_t* m = mask.ptr<uint8_t>(y);
+
+                    for (; x + 8 <= cols; x += 8)
+                    {
+                        uint64_t mv = loadMask8(m + x);
+
+                        if (mv == 0)
+                        {
+                            continue;
+                        }
+
+                        if (isMask8AllSet(mv))
+                        {
+                            for (int k = 0; k < 8; k++)
+                            {
+                                hs[k % CounterCount][toHistBin(ps[x + k], offset, binShift)]++;
+                            }
+                        }
+                        else
+                        {
+                            for (int k = 0; k < 8; k++)
+                            {
+                                if (m[x + k])
+                                {
+                                    hs[k % CounterCount][toHistBin(ps[x + k], offset, binShift)]++;
+                                }
+                            }
+                        }
+                    }
+
+                    for (; x < cols; x++)
+                    {
+                        if (m[x])
+                        {
+                            h0[toHistBin(ps[x], offset, binShift)]++;
+                        }
+                    }
+
+                    continue;
+                }
+
+                if constexpr (CounterCount == 4)
+                {
+                    for (; x + 4 <= cols; x += 4)
+                    {
+                        h0[toHistBin(ps[x], offset, binShift)]++;
+                        h1[toHistBin(ps[x + 1], offset, binShift)]++;
+                        h2[toHistBin(ps[x + 2], offset, binShift)]++;
+                        h3[toHistBin(ps[x + 3], offset, binShift)]++;
+                    }
+                }
+                else if constexpr (CounterCount == 2)
+                {
+                    for (; x + 2 <= cols; x += 2)
+                    {
+                        h0[toHistBin(ps[x], offset, binShift)]++;
+                        h1[toHistBin(ps[x + 1], offset, binShift)]++;
+                    }
+                }
+
+                for (; x < cols; x++)
+                {
+                    h0[toHistBin(ps[x], offset, binShift)]++;
+                }
+            }
+        }
+
+        /**
+         * @brief Get scratch space of at least the specified size, kept per calling thread so that steady-state
+         * histogramming does not allocate. Contents are not zeroed.
+         */
+        static int* getHistWorkspace(size_t size)
+        {
+            static thread_local std::vector<int> workspace;
+
+            if (workspace.size() < size)
+            {
+                workspace.resize(size);
+            }
+
+            return workspace.data();
+        }
+
+        /**
+         * @brief Sum subCount consecutive histograms of binCount bins each into counts, parallel over bins.
+         */
+        static void mergeSubHists(const int* sub, int subCount, int binCount, int* counts)
+        {
+            int stripeCount = ParallelUtil::getStripeCount(binCount, subCount);
+
+            ParallelUtil::parallelForStripes(binCount, stripeCount, [&](int, int b0, int b1)
+            {
+                std::fill(counts + b0, counts + b1, 0);
+
+                for (int i = 0; i < subCount; i++)
+                {
+                    const int* h = sub + (size_t)i * binCount;
+
+                    for (int b = b0; b < b1; b++)
+                    {
+                        counts[b] += h[b];
+                    }
+                }
+            });
+        }
+
+        /**
+         * @brief Row-parallel histogram with privatized bins, bin index is (v - offset) >> binShift.
+         * Each stripe fills its own set of sub-histograms (no sharing between threads), then they are summed
+         * per bin, also in parallel for large bin counts.
+         * @param mask Empty, or 8U the same size as img. Only pixels where it is nonzero are counted.
+         * @param counts Output, resized to binCount. Does not allocate if it is already that size.
+         */
+        template <typename T>
+        static void histIntParallel(const cv::Mat& img, const cv::Mat& mask, int32_t offset, int binShift, int binCount, std::vector<int>& counts)
+        {
+            // 16-bit sub-histograms are 256 KB each so only use 2 counters to stay in cache
+            constexpr int counterCount = (sizeof(T) == 1) ? 4 : 2;
+
+            // one stripe per thread since each stripe costs a full set of bins
+            int stripeCount = std::min(ParallelUtil::getStripeCount(img.rows, img.cols), std::max(1, cv::getNumThreads()));
+            int subCount = stripeCount * counterCount;
+            int* sub = getHistWorkspace((size_t)subCount * binCount);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int s, int r0, int r1)
+            {
+                int* stripeSub = sub + (size_t)s * counterCount * binCount;
+                std::fill(stripeSub, stripeSub + (size_t)counterCount * binCount, 0);
+
+                if (mask.empty())
+                {
+                    histIntRows<T, counterCount, false>(img, mask, r0, r1, offset, binShift, binCount, stripeSub);
+                }
+                else
+                {
+                    histIntRows<T, counterCount, true>(img, mask, r0, r1, offset, binShift, binCount, stripeSub);
+                }
+            });
+
+            counts.resize(binCount);
+            mergeSubHists(sub, subCount, binCount, counts.data());
+        }
+
+        std::vector<int> histInt(cv::Mat& img, const cv::Mat& mask)
+        {
+            return histInt(img, 0, mask);
+        }
+
+        void histInt(cv::Mat& img, std::vector<int>& counts, const cv::Mat& mask)
+        {
+            histInt(img, 0, counts, mask);
+        }
+
+        /**
+         * @brief Hist on an integer image (8U, 16U, 16S, 32S) with bins fit to the actual value range.
+         * This is mainly for 32S where the full value range cannot be binned directly.
+         * Bin i holds values offset + (i << binShift) up to (but not including) offset + ((i + 1) << binShift).
+         * binShift is the smallest that fits the range into maxBinCount bins, so ranges up to maxBinCount are exact.
+         * Takes one pass for min/max and one for the hist, both parallel.
+         * @param img
+         * @param maxBinCount At least 1.
+         * @param counts Output, empty if the image is empty (or the mask excludes everything).
+         * @param offset Output, the value at the bottom of bin 0, which is the image min.
+         * @param binShift Output
+         * @param mask Optional 8U mask, same size as img. Only pixels where the mask is nonzero are counted, and the range
+         *     is fit to just those.
+         */
+        void histIntAdaptive(cv::Mat& img, int maxBinCount, std::vector<int>& counts, int& offset, int& binShift, const cv::Mat& mask)
+        {
+            CV_Assert(maxBinCount >= 1);
+            offset = 0;
+            binShift = 0;
+            checkHistMask(img, mask);
+
+            if (img.empty())
+            {
+                counts.clear();
+                return;
+            }
+
+            double minVal, maxVal;
+
+            if (mask.empty())
+            {
+                imgMinMax(img, minVal, maxVal);
+            }
+            else
+            {
+                MinMaxLoc found = imgMinMaxLoc(img, mask);
+
+                if (found.minLoc.x < 0)
+                {
+                    counts.clear();
+                    return;
+                }
+
+                minVal = found.minVal;
+                maxVal = found.maxVal;
+            }
+
+            offset = (int)minVal;
+            int64_t range = (int64_t)maxVal - (int64_t)minVal + 1;
+
+            while ((range + (1ll << binShift) - 1) >> binShift > maxBinCount)
+            {
+                binShift++;
+            }
+
+            int binCount = (int)((range + (1ll << binShift) - 1) >> binShift);
+
+            switch (img.type())
+            {
+            case CV_8U:
+                histIntParallel<uint8_t>(img, mask, offset, binShift, binCount, counts);
+                break;
+            case CV_16U:
+                histIntParallel<uint16_t>(img, mask, offset, binShift, binCount, counts);
+                break;
+            case CV_16S:
+                histIntParallel<int16_t>(img, mask, offset, binShift, binCount, counts);
+                break;
+            case CV_32S:
+                histIntParallel<int32_t>(img, mask, offset, binShift, binCount, counts);
+                break;
+            default:
+                bail("histIntAdaptive: Unsupported image type");
+            }
+        }
+
+        /**
+         * @brief histIntAdaptive over an ROI of the image, in place (no copy).
+         * @param img
+         * @param roi Must be inside the image.
+         * @param maxBinCount
+         * @param counts Output
+         * @param offset Output, the min in the roi.
+         * @param binShift Output
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         */
+        void histIntAdaptive(cv::Mat& img, const cv::Rect& roi, int maxBinCount, std::vector<int>& counts, int& offset, int& binShift, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            histIntAdaptive(imgRoi, maxBinCount, counts, offset, binShift, mask.empty() ? mask : mask(roi));
+        }
+
+        /**
+         * @brief Running totals of a histogram, cumCounts[i] is the sum of counts[0] to counts[i].
+         * Build this once and then any number of percentiles are each a binary search, see histPercentileFromCumulative.
+         */
+        void histCumulative(const std::vector<int>& counts, std::vector<int64_t>& cumCounts)
+        {
+            cumCounts.resize(counts.size());
+            int64_t total = 0;
+
+            for (size_t i = 0; i < counts.size(); i++)
+            {
+                total += counts[i];
+                cumCounts[i] = total;
+            }
+        }
+
+        /**
+         * @brief Nearest-rank percentile from cumulative counts in O(log bins), same result as histPercentiles for the same hist.
+         * @param cumCounts From histCumulative.
+         * @param pct 0 to 100.
+         * @param offset Value of bin 0, e.g. Hist16sOffset for 16S or the offset from histIntAdaptive.
+         * @param binShift Bin width as a shift, as passed to histInt.
+         * @return Bottom value of the bin holding the percentile, NAN if the hist is empty.
+         */
+        float histPercentileFromCumulative(const std::vector<int64_t>& cumCounts, float pct, int offset, int binShift)
+        {
+            int64_t n = cumCounts.empty() ? 0 : cumCounts.back();
+
+            if (n == 0)
+            {
+                return NAN;
+            }
+
+            int64_t rank = std::clamp<int64_t>((int64_t)std::ceil((double)pct / 100.0 * n) - 1, 0, n - 1);
+            int64_t bin = std::upper_bound(cumCounts.begin(), cumCounts.end(), rank) - cumCounts.begin();
+            return (float)(offset + (bin << binShift));
+        }
+
+        /**
+         * @brief Mean, variance and mode from an integer histogram, without another pass over the image.
+         * Each bin counts as its center value, so with binShift 0 these are exact.
+         * @param counts From histInt or histIntAdaptive.
+         * @param offset Value of bin 0.
+         * @param binShift Bin width as a shift.
+         * @return Mean and variance are NAN if the hist is empty.
+         */
+        HistMoments histMoments(const std::vector<int>& counts, int offset, int binShift)
+        {
+            HistMoments moments;
+
+            // binShift can be 32 for 32S
+            double binWidth = std::ldexp(1.0, binShift);
+            double halfBin = (binWidth - 1.0) / 2.0;
+            double sum = 0.0;
+            int modeBin = 0;
+
+            for (int b = 0; b < (int)counts.size(); b++)
+            {
+                moments.count += counts[b];
+                sum += (double)counts[b] * ((double)b * binWidth);
+                modeBin = (counts[b] > counts[modeBin]) ? b : modeBin;
+            }
+
+            if (moments.count == 0)
+            {
+                moments.mean = NAN;
+                moments.variance = NAN;
+                moments.mode = NAN;
+                return moments;
+            }
+
+            // relative to bin 0's center, then shifted, to keep precision for large offsets
+            double meanRel = sum / moments.count;
+            double m2 = 0.0;
+
+            for (int b = 0; b < (int)counts.size(); b++)
+            {
+                double d = (double)b * binWidth - meanRel;
+                m2 += (double)counts[b] * d * d;
+            }
+
+            moments.mean = offset + halfBin + meanRel;
+            moments.variance = m2 / moments.count;
+            moments.mode = (float)(offset + halfBin + (double)modeBin * binWidth);
+            return moments;
+        }
+
+        /**
+         * @brief Histogram a stripe of rows into uniform float bins, channel 0 only.
+         * Bin index is (v - minVal) * scale with a branch-free clamp, and values outside minVal to maxVal (and NAN) get
+         * weight 0 instead of a branch, so the index computation vectorizes.
+         * A mask is folded into the weight the same way, and a batch that is entirely masked out is skipped.
+         * @param sub binCount ints, zeroed.
+         */
+        template <typename T, bool HasMask>
+        static void histFloatRows(const cv::Mat& img, const cv::Mat& mask, int r0, int r1, float minVal, float maxVal, float scale, int binCount, int* sub)
+        {
+            const int batchSize = 64;
+            int idxs[batchSize];
+            int weights[batchSize];
+            int cn = img.channels();
+            float lastBin = (float)(binCount - 1);
+
+            for (int y = r0; y < r1; y++)
+            {
+                const T* p = img.ptr<T>(y);
+                const uint8_t* m = HasMask ? mask.ptr<uint8_t>(y) : nullptr;
+
+                for (int x0 = 0; x0 < img.cols; x0 += batchSize)
+                {
+                    int n = std::min(batchSize, img.cols - x0);
+
+                    if constexpr (HasMask)
+                    {
+                        uint64_t any = 0;
+                        int k = 0;
+
+                        for (; k + 8 <= n; k += 8)
+                        {
+                            any |= loadMask8(m + x0 + k);
+                        }
+
+                        for (; k < n; k++)
+                        {
+                            any |= m[x0 + k];
+                        }
+
+                        if (any == 0)
+                        {
+                            continue;
+                        }
+                    }
+
+                    for (int k = 0; k < n; k++)
+                    {
+                        float v = (float)p[(x0 + k) * cn];
+                        float t = (v - minVal) * scale;
+                        t = (t > 0.0f) ? t : 0.0f; // also takes NAN to 0
+                        t = (t < lastBin) ? t : lastBin;
+                        idxs[k] = (int)t;
+                        weights[k] = (int)((v >= minVal) && (v <= maxVal));
+
+                        if constexpr (HasMask)
+                        {
+                            weights[k] &= (int)(m[x0 + k] != 0);
+                        }
+                    }
+
+                    for (int k = 0; k < n; k++)
+                    {
+                        sub[idxs[k]] += weights[k];
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Row-parallel float-bin histogram with per-thread bins from the workspace, summed directly into counts.
+         */
+        template <typename T>
+        static void histFloatParallel(const cv::Mat& img, const cv::Mat& mask, float minVal, float maxVal, int binCount, std::vector<int>& counts)
+        {
+            int stripeCount = std::min(ParallelUtil::getStripeCount(img.rows, img.cols), std::max(1, cv::getNumThreads()));
+            float scale = binCount / (maxVal - minVal);
+            counts.resize(binCount);
+
+            if (stripeCount == 0)
+            {
+                std::fill(counts.begin(), counts.end(), 0);
+                return;
+            }
+
+            int* sub = getHistWorkspace((size_t)stripeCount * binCount);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int s, int r0, int r1)
+            {
+                int* h = sub + (size_t)s * binCount;
+                std::fill(h, h + binCount, 0);
+
+                if (mask.empty())
+                {
+                    histFloatRows<T, false>(img, mask, r0, r1, minVal, maxVal, scale, binCount, h);
+                }
+                else
+                {
+                    histFloatRows<T, true>(img, mask, r0, r1, minVal, maxVal, scale, binCount, h);
+                }
+            });
+
+            mergeSubHists(sub, stripeCount, binCount, counts.data());
+        }
+
+        /**
+         * @brief Uniform hist on any type of image but uses float for bins.
+         * If maxVal <= minVal then this ignores binCount and returns a single bin (at minVal) with count 0.
+         * This is a native row-parallel pass that writes counts straight into hist (no allocation once hist and the thread's
+         * workspace are big enough). If maxVal is NAN there is one more pass before it, the vectorized imgMinMax.
+         * Values outside minVal to maxVal, and NAN, are not counted. For multi-channel images only channel 0 is
+         * histogrammed (the default maxVal is over all channels).
+         * @param img
+         * @param binCount
+         * @param minVal Bottom of first bin. If NAN then choose a default. Default is 0.
+         * @param maxVal Top of last bin. If NAN then choose a default. Default is max value in image. On return this is
+         *     increased by a tenth of a bin, as an exclusive top that still includes the max value.
+         * @param bins
+         * @param hist
+         * @param mask Optional 8U mask, same size as img. Only pixels where the mask is nonzero are counted, and the default
+         *     maxVal is over just those.
+         */
+        void histFloat(cv::Mat& img, int binCount, float& minVal, float& maxVal, vector<float>& bins, vector<int>& hist, const cv::Mat& mask)
+        {
+            checkHistMask(img, mask);
+
+            if (std::isnan(minVal))
+            {
+                minVal = 0;
+            }
+
+            if (std::isnan(maxVal))
+            {
+                if (mask.empty())
+                {
+                    double foundMin, foundMax;
+                    imgMinMax(img, foundMin, foundMax);
+                    maxVal = (float)foundMax;
+                }
+                else
+                {
+                    ImageStats stats = computeStats(img, mask);
+                    maxVal = (stats.count > 0) ? stats.maxVal : NAN;
+                }
+            }
+
+            // no non-nan values in image
+            if (std::isnan(maxVal))
+            {
+                bins.clear();
+                hist.clear();
+                return;
+            }
+
+            if (maxVal <= minVal)
+            {
+                bins.resize(1);
+                bins[0] = minVal;
+                hist.resize(1);
+                hist[0] = 0;
+                return;
+            }
+
+            // bins
+            bins.resize(binCount);
+            float binSize = (maxVal - minVal) / binCount;
+
+            for (int i = 0; i < binCount; i++)
+            {
+                bins[i] = minVal + i * binSize;
+            }
+
+            // hist, the top value is included
+            switch (img.depth())
+            {
+            case CV_8U:
+                histFloatParallel<uint8_t>(img, mask, minVal, maxVal, binCount, hist);
+                break;
+            case CV_8S:
+                histFloatParallel<int8_t>(img, mask, minVal, maxVal, binCount, hist);
+                break;
+            case CV_16U:
+                histFloatParallel<uint16_t>(img, mask, minVal, maxVal, binCount, hist);
+                break;
+            case CV_16S:
+                histFloatParallel<int16_t>(img, mask, minVal, maxVal, binCount, hist);
+                break;
+            case CV_32S:
+                histFloatParallel<int32_t>(img, mask, minVal, maxVal, binCount, hist);
+                break;
+            case CV_32F:
+                histFloatParallel<float>(img, mask, minVal, maxVal, binCount, hist);
+                break;
+            case CV_64F:
+                histFloatParallel<double>(img, mask, minVal, maxVal, binCount, hist);
+                break;
+            default:
+                bail("histFloat: Unsupported image type");
+            }
+
+            // report an exclusive top like before, a little over the max value
+            maxVal += 0.1f * binSize;
+        }
+
+        void histFloat(cv::Mat& img, int binCount, float minVal, float maxVal, FloatHist& hist, const cv::Mat& mask)
+        {
+            hist.binMode = FloatHistBinMode::Uniform;
+            hist.minVal = minVal;
+            hist.maxVal = maxVal;
+            histFloat(img, binCount, hist.minVal, hist.maxVal, hist.bins, hist.counts, mask);
+            hist.invalidateCumulative();
+        }
+
+        FloatHist histFloat(cv::Mat& img, int binCount, float minVal, float maxVal, const cv::Mat& mask)
+        {
+            FloatHist hist;
+            histFloat(img, binCount, minVal, maxVal, hist, mask);
+            return hist;
+        }
+
+        /**
+         * @brief Float-bin hist over an ROI of the image, in place (no copy), see histFloat.
+         * @param img
+         * @param roi Must be inside the image.
+         * @param binCount
+         * @param minVal Bottom of first bin, NAN for the default.
+         * @param maxVal Top of last bin, NAN for the default (the max value in the roi).
+         * @param hist Output
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         */
+        void histFloat(cv::Mat& img, const cv::Rect& roi, int binCount, float minVal, float maxVal, FloatHist& hist, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            histFloat(imgRoi, binCount, minVal, maxVal, hist, mask.empty() ? mask : mask(roi));
+        }
+
+        /**
+         * @brief Float-bin hist over an ROI of the image into bins and counts, in place (no copy), see histFloat.
+         * @param img
+         * @param roi Must be inside the image.
+         * @param binCount
+         * @param minVal Bottom of first bin, NAN for the default. Updated like histFloat.
+         * @param maxVal Top of last bin, NAN for the default (the max value in the roi). Updated like histFloat.
+         * @param bins Output
+         * @param hist Output
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         */
+        void histFloat(cv::Mat& img, const cv::Rect& roi, int binCount, float& minVal, float& maxVal, vector<float>& bins, vector<int>& hist, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            histFloat(imgRoi, binCount, minVal, maxVal, bins, hist, mask.empty() ? mask : mask(roi));
+        }
+
+        template <typename T>
+        static void sketchRows(const cv::Mat& img, const cv::Mat& mask, int r0, int r1, QuantileSketch& sketch)
+        {
+            int cn = img.channels();
+            int n = img.cols * cn;
+
+            for (int y = r0; y < r1; y++)
+            {
+                const T* p = img.ptr<T>(y);
+
+                if (mask.empty())
+                {
+                    for (int x = 0; x < n; x++)
+                    {
+                        sketch.add((float)p[x]);
+                    }
+                }
+                else
+                {
+                    forEachUnmasked(mask.ptr<uint8_t>(y), img.cols, [&](int x)
+                    {
+                        for (int c = 0; c < cn; c++)
+                        {
+                            sketch.add((float)p[x * cn + c]);
+                        }
+                    });
+                }
+            }
+        }
+
+        /**
+         * @brief Add all values of an image to a quantile sketch, any depth and channel count (all channels together).
+         * NAN is skipped. Stripes are sketched in parallel and merged in order, so the result does not depend on scheduling.
+         * @param img
+         * @param sketch Values are added to what it already holds.
+         * @param mask Optional 8U mask, same size as img. Only pixels where the mask is nonzero are added (all channels).
+         */
+        void sketchImage(cv::Mat& img, QuantileSketch& sketch, const cv::Mat& mask)
+        {
+            checkHistMask(img, mask);
+
+            if ((img.depth() == CV_16F) || (img.depth() > CV_64F))
+            {
+                bail("sketchImage: Unsupported image type");
+            }
+
+            int stripeCount = ParallelUtil::getStripeCount(img.rows, img.cols * img.channels());
+            std::vector<QuantileSketch> parts(stripeCount, QuantileSketch(sketch.compression));
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int s, int r0, int r1)
+            {
+                switch (img.depth())
+                {
+                case CV_8U:
+                    sketchRows<uint8_t>(img, mask, r0, r1, parts[s]);
+                    break;
+                case CV_8S:
+                    sketchRows<int8_t>(img, mask, r0, r1, parts[s]);
+                    break;
+                case CV_16U:
+                    sketchRows<uint16_t>(img, mask, r0, r1, parts[s]);
+                    break;
+                case CV_16S:
+                    sketchRows<int16_t>(img, mask, r0, r1, parts[s]);
+                    break;
+                case CV_32S:
+                    sketchRows<int32_t>(img, mask, r0, r1, parts[s]);
+                    break;
+                case CV_32F:
+                    sketchRows<float>(img, mask, r0, r1, parts[s]);
+                    break;
+                case CV_64F:
+                    sketchRows<double>(img, mask, r0, r1, parts[s]);
+                    break;
+                }
+            });
+
+            for (const QuantileSketch& part : parts)
+            {
+                sketch.merge(part);
+            }
+        }
+
+        QuantileSketch sketchImage(cv::Mat& img, float compression, const cv::Mat& mask)
+        {
+            QuantileSketch sketch(compression);
+            sketchImage(img, sketch, mask);
+            return sketch;
+        }
+
+        /**
+         * @brief Compute hist on 8U, 16U or 16S image. Bin width is specified by a bit shift for perf.
+         * 16S is offset-binned, bin 0 is -32768 (Hist16sOffset).
+         * This is row-parallel with per-thread bins.
+         * @param img
+         * @param binShift bit-shift divisor for how wide bins are
+         * @param mask Optional 8U mask, same size as img.
+         * @return
+         */
+        std::vector<int> histInt(cv::Mat& img, int binShift, const cv::Mat& mask)
+        {
+            std::vector<int> counts;
+            histInt(img, binShift, counts, mask);
+            return counts;
+        }
+
+        /**
+         * @brief Compute hist on 8U, 16U or 16S image into a caller-owned buffer.
+         * Steady-state calls with the same buffer and bin count do no heap work.
+         * @param img
+         * @param binShift bit-shift divisor for how wide bins are
+         * @param counts Output, resized to the bin count (256 >> binShift for 8U, 65536 >> binShift for 16U and 16S).
+         *     16S is offset-binned, bin 0 is -32768 (Hist16sOffset).
+         * @param mask Optional 8U mask, same size as img. Only pixels where the mask is nonzero are counted.
+         */
+        void histInt(cv::Mat& img, int binShift, std::vector<int>& counts, const cv::Mat& mask)
+        {
+            checkHistMask(img, mask);
+
+            if (img.type() == CV_8U)
+            {
+                histIntParallel<uint8_t>(img, mask, 0, binShift, 256 >> binShift, counts);
+            }
+            else if (img.type() == CV_16U)
+            {
+                histIntParallel<uint16_t>(img, mask, 0, binShift, 65536 >> binShift, counts);
+            }
+            else if (img.type() == CV_16S)
+            {
+                histIntParallel<int16_t>(img, mask, Hist16sOffset, binShift, 65536 >> binShift, counts);
+            }
+            else
+            {
+                bail("histInt: Type not handled yet.");
+            }
+        }
+
+        /**
+         * @brief Compute hist on an ROI of an 8U, 16U or 16S image, in place (no copy).
+         * @param img
+         * @param roi Must be inside the image.
+         * @param binShift bit-shift divisor for how wide bins are
+         * @param counts Output, see histInt.
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         */
+        void histInt(cv::Mat& img, const cv::Rect& roi, int binShift, std::vector<int>& counts, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            histInt(imgRoi, binShift, counts, mask.empty() ? mask : mask(roi));
+        }
+
+        template <typename T, bool HasMask>
+        static void histTopKey16Rows(const cv::Mat& img, const cv::Mat& mask, int r0, int r1, int* h)
+        {
+            for (int y = r0; y < r1; y++)
+            {
+                const T* p = img.ptr<T>(y);
+
+                auto addPixel = [&](int x)
+                {
+                    T v = p[x];
+
+                    if (v == v)
+                    {
+                        h[toOrderedKey(v) >> 16]++;
+                    }
+                };
+
+                if constexpr (HasMask)
+                {
+                    forEachUnmasked(mask.ptr<uint8_t>(y), img.cols, addPixel);
+                }
+                else
+                {
+                    for (int x = 0; x < img.cols; x++)
+                    {
+                        addPixel(x);
+                    }
+                }
+            }
+        }
+
+        template <typename T>
+        static void histTopKey16Parallel(const cv::Mat& img, const cv::Mat& mask, std::vector<int>& counts)
+        {
+            const int binCount = 65536;
+            int stripeCount = std::min(ParallelUtil::getStripeCount(img.rows, img.cols), std::max(1, cv::getNumThreads()));
+            counts.resize(binCount);
+
+            if (stripeCount == 0)
+            {
+                std::fill(counts.begin(), counts.end(), 0);
+                return;
+            }
+
+            int* sub = getHistWorkspace((size_t)stripeCount * binCount);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int s, int r0, int r1)
+            {
+                int* h = sub + (size_t)s * binCount;
+                std::fill(h, h + binCount, 0);
+
+                if (mask.empty())
+                {
+                    histTopKey16Rows<T, false>(img, mask, r0, r1, h);
+                }
+                else
+                {
+                    histTopKey16Rows<T, true>(img, mask, r0, r1, h);
+                }
+            });
+
+            mergeSubHists(sub, stripeCount, binCount, counts.data());
+        }
+
+        /**
+         * @brief 65536-bin histogram of the top 16 bits of each value's ordered key (see toOrderedKey), NAN skipped.
+         * Row-parallel with per-thread bins.
+         * @param img 32F or 32S.
+         * @param counts Output, resized to 65536.
+         * @param mask Optional 8U mask, same size as img.
+         */
+        void histTopKey16(const cv::Mat& img, std::vector<int>& counts, const cv::Mat& mask)
+        {
+            checkHistMask(img, mask);
+
+            if (img.type() == CV_32F)
+            {
+                histTopKey16Parallel<float>(img, mask, counts);
+            }
+            else if (img.type() == CV_32S)
+            {
+                histTopKey16Parallel<int32_t>(img, mask, counts);
+            }
+            else
+            {
+                bail("histTopKey16: Unsupported image type");
+            }
+        }
+
+        /**
+         * @brief Most 65536-bin second level histograms percentilesRadix holds at once, summed over stripes (16 MB).
+         */
+        static const int Percentile2ndLevelMaxSlots = 64;
+
+        /**
+         * @brief Exact (or for 32F, bounded relative error) percentiles on a 32F or 32S image by a two-level radix select on
+         * the value bits.
+         * The first pass histograms the top 16 bits of each value's ordered key, which finds the bin holding each target
+         * rank. The second pass histograms the low 16 bits of only the values in those bins, which gives exact values.
+         * Both passes are row-parallel with per-thread bins. The second pass is repeated per group of target bins if there
+         * are more than fit in Percentile2ndLevelMaxSlots, so memory is bounded for any number of percentiles.
+         * NAN is skipped, like imgMinMax, but +-INF is included and sorts at the ends.
+         * Percentiles use nearest-rank, see findPercentilesInHist.
+         * @param img 32F or 32S image, T must match.
+         * @param pcts Percentiles to compute, 0 to 100.
+         * @param pctCount
+         * @param tolerance 32F only, allowed relative error. If this is at least Percentile32fCoarseRelError then the second pass
+         *     is skipped and results are rounded toward zero to the first level bin edge. Otherwise results are exact.
+         * @param results Output, one per percentile, NAN if there are no non-NAN (unmasked) values.
+         * @param mask Empty, or 8U the same size as img. Only pixels where it is nonzero are included, in both passes.
+         */
+        template <typename T>
+        static void percentilesRadix(const cv::Mat& img, const float* pcts, int pctCount, float tolerance, float* results, const cv::Mat& mask)
+        {
+            const int binCount = 65536;
+            int stripeCount = std::min(ParallelUtil::getStripeCount(img.rows, img.cols), std::max(1, cv::getNumThreads()));
+            int cols = img.cols;
+
+            // level 1: top 16 bits
+            static thread_local std::vector<int> topCounts;
+            histTopKey16(img, topCounts, mask);
+
+            int64_t n = 0;
+
+            for (int b = 0; b < binCount; b++)
+            {
+                n += topCounts[b];
+            }
+
+            if (n == 0)
+            {
+                std::fill(results, results + pctCount, NAN);
+                return;
+            }
+
+            std::vector<int> targetBins(pctCount);
+            std::vector<int64_t> ranksInBin(pctCount);
+            findPercentilesInHist(topCounts.data(), binCount, n, pcts, pctCount, targetBins.data(), ranksInBin.data());
+
+            if (std::is_same_v<T, float> && (tolerance >= Percentile32fCoarseRelError))
+            {
+                for (int i = 0; i < pctCount; i++)
+                {
+                    results[i] = (float)topKeyBinEdge<T>(targetBins[i]);
+                }
+
+                return;
+            }
+
+            // level 2: low 16 bits, only for values in the target bins, each target bin gets a slot of 65536 bins
+            static thread_local std::vector<int> slotOfBin;
+            slotOfBin.assign(binCount, -1);
+            std::vector<int> slotBins;
+
+            for (int i = 0; i < pctCount; i++)
+            {
+                if (slotOfBin[targetBins[i]] < 0)
+                {
+                    slotOfBin[targetBins[i]] = (int)slotBins.size();
+                    slotBins.push_back(targetBins[i]);
+                }
+            }
+
+            // slots times stripes is at most Percentile2ndLevelMaxSlots, so many percentiles in different bins take
+            // a pass per group of slots instead of unbounded memory
+            int slotCount = (int)slotBins.size();
+            int passStripeCount = std::min(stripeCount, Percentile2ndLevelMaxSlots);
+            int slotsPerPass = std::max(1, Percentile2ndLevelMaxSlots / passStripeCount);
+            const int* slots = slotOfBin.data();
+            static thread_local std::vector<int> lowCounts;
+
+            for (int slot0 = 0; slot0 < slotCount; slot0 += slotsPerPass)
+            {
+                int passSlotCount = std::min(slotsPerPass, slotCount - slot0);
+                size_t subSize = (size_t)passSlotCount * binCount;
+                int* sub = getHistWorkspace((size_t)passStripeCount * subSize);
+
+                ParallelUtil::parallelForStripes(img.rows, passStripeCount, [&](int s, int r0, int r1)
+                {
+                    int* h = sub + (size_t)s * subSize;
+                    std::fill(h, h + subSize, 0);
+
+                    for (int y = r0; y < r1; y++)
+                    {
+                        const T* p = img.ptr<T>(y);
+
+                        auto addPixel = [&](int x)
+                        {
+                            T v = p[x];
+
+                            if (v == v)
+                            {
+                                uint32_t key = toOrderedKey(v);
+
+                                // also rejects -1, not a target bin
+                                uint32_t slot = (uint32_t)(slots[key >> 16] - slot0);
+
+                                if (slot < (uint32_t)passSlotCount)
+                                {
+                                    h[(size_t)slot * binCount + (key & 0xFFFFu)]++;
+                                }
+                            }
+                        };
+
+                        if (mask.empty())
+                        {
+                            for (int x = 0; x < cols; x++)
+                            {
+                                addPixel(x);
+                            }
+                        }
+                        else
+                        {
+                            forEachUnmasked(mask.ptr<uint8_t>(y), cols, addPixel);
+                        }
+                    }
+                });
+
+                lowCounts.resize(subSize);
+                mergeSubHists(sub, passStripeCount, (int)subSize, lowCounts.data());
+
+                for (int i = 0; i < pctCount; i++)
+                {
+                    int slot = slotOfBin[targetBins[i]] - slot0;
+
+                    if ((slot < 0) || (slot >= passSlotCount))
+                    {
+                        continue;
+                    }
+
+                    const int* h = lowCounts.data() + (size_t)slot * binCount;
+                    int64_t cum = 0;
+                    int lb = 0;
+
+                    while (cum + h[lb] <= ranksInBin[i])
+                    {
+                        cum += h[lb];
+                        lb++;
+                    }
+
+                    results[i] = (float)fromOrderedKey<T>(((uint32_t)targetBins[i] << 16) | (uint32_t)lb);
+                }
+            }
+        }
+
+        /**
+         * @brief Compute any number of percentiles on an image from one histogram build and one cumulative scan.
+         * 8U, 16U and 16S use histInt. 32F and 32S use an exact two-pass radix select (see percentilesRadix), which is still
+         * a single histogram build for all of the percentiles.
+         * Percentiles use nearest-rank, so 0 is the min and 100 is the max. NAN is ignored.
+         * @param img
+         * @param pcts Percentiles to compute, 0 to 100, any order.
+         * @param results Output, one per percentile. NAN if the image has no (non-NAN, unmasked) values.
+         * @param mask Optional 8U mask, same size as img. Only pixels where the mask is nonzero are included.
+         */
+        void histPercentiles(cv::Mat& img, const std::vector<float>& pcts, std::vector<float>& results, const cv::Mat& mask)
+        {
+            int pctCount = (int)pcts.size();
+            results.resize(pctCount);
+            checkHistMask(img, mask);
+
+            if (pctCount == 0)
+            {
+                return;
+            }
+
+            int type = img.type();
+
+            if ((type == CV_8U) || (type == CV_16U) || (type == CV_16S))
+            {
+                static thread_local std::vector<int> counts;
+                static thread_local std::vector<int> binIdxs;
+                histInt(img, 0, counts, mask);
+                binIdxs.resize(pctCount);
+                int64_t n = 0;
+
+                for (int c : counts)
+                {
+                    n += c;
+                }
+
+                if (n == 0)
+                {
+                    std::fill(results.begin(), results.end(), NAN);
+                    return;
+                }
+
+                findPercentilesInHist(counts.data(), (int)counts.size(), n, pcts.data(), pctCount, binIdxs.data());
+
+                int binOffset = (type == CV_16S) ? Hist16sOffset : 0;
+
+                for (int i = 0; i < pctCount; i++)
+                {
+                    results[i] = (float)(binIdxs[i] + binOffset);
+                }
+            }
+            else if (type == CV_32F)
+            {
+                percentilesRadix<float>(img, pcts.data(), pctCount, 0.0f, results.data(), mask);
+            }
+            else if (type == CV_32S)
+            {
+                percentilesRadix<int32_t>(img, pcts.data(), pctCount, 0.0f, results.data(), mask);
+            }
+            else
+            {
+                bail("histPercentiles: Unsupported image type");
+            }
+        }
+
+        std::vector<float> histPercentiles(cv::Mat& img, const std::vector<float>& pcts, const cv::Mat& mask)
+        {
+            std::vector<float> results;
+            histPercentiles(img, pcts, results, mask);
+            return results;
+        }
+
+        /**
+         * @brief Compute any number of percentiles over an ROI of the image, in place (no copy), see histPercentiles.
+         * @param img
+         * @param roi Must be inside the image.
+         * @param pcts Percentiles to compute, 0 to 100, any order.
+         * @param results Output, one per percentile.
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         */
+        void histPercentiles(cv::Mat& img, const cv::Rect& roi, const std::vector<float>& pcts, std::vector<float>& results, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            histPercentiles(imgRoi, pcts, results, mask.empty() ? mask : mask(roi));
+        }
+
+        /**
+         * @brief Compute two percentiles on 8u or 16u image.
+         * @param img
+         * @param lowPct Percentile to compute, 0 to 100
+         * @param highPct Percentile to compute, 0 to 100
+         * @param mask Optional 8U mask, same size as img.
+         * @return The percentiles, or (0, 0) if there are no values (empty image, or the mask excludes everything).
+         *     histPercentiles returns NAN for that instead.
+         */
+        std::pair<int, int> histPercentilesInt(cv::Mat& img, float lowPct, float highPct, const cv::Mat& mask)
+        {
+            if ((img.type() == CV_8U) || (img.type() == CV_16U))
+            {
+                static thread_local std::vector<float> pcts(2);
+                static thread_local std::vector<float> results;
+                pcts[0] = lowPct;
+                pcts[1] = highPct;
+                histPercentiles(img, pcts, results, mask);
+
+                if (std::isnan(results[0]))
+                {
+                    return std::pair<int, int>(0, 0);
+                }
+
+                return std::pair<int, int>((int)results[0], (int)results[1]);
+            }
+            else
+            {
+                bail("histPercentiles: Unsupported image type");
+                return std::pair<int, int>(0, 0); // compiler warning
+            }
+        }
+
+        /**
+         * @brief histPercentilesInt over an ROI of the image, in place (no copy).
+         * @param img
+         * @param roi Must be inside the image.
+         * @param lowPct Percentile to compute, 0 to 100
+         * @param highPct Percentile to compute, 0 to 100
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         * @return
+         */
+        std::pair<int, int> histPercentilesInt(cv::Mat& img, const cv::Rect& roi, float lowPct, float highPct, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            return histPercentilesInt(imgRoi, lowPct, highPct, mask.empty() ? mask : mask(roi));
+        }
+
+        /**
+         * @brief Compute two percentiles on 32f image.
+         * These are exact values from the image (see percentilesRadix), unless tolerance allows a single-pass approximation.
+         * NAN is ignored.
+         * @param img
+         * @param lowPct Percentile to compute, 0 to 100
+         * @param highPct Percentile to compute, 0 to 100
+         * @param tolerance Allowed relative error, 0 for exact. Anything less than about 0.8% is exact (two passes).
+         * @param mask Optional 8U mask, same size as img.
+         * @return
+         */
+        std::pair<float, float> histPercentiles32f(cv::Mat& img, float lowPct, float highPct, float tolerance, const cv::Mat& mask)
+        {
+            if (img.type() == CV_32F)
+            {
+                float pcts[2] = { lowPct, highPct };
+                float results[2];
+                checkHistMask(img, mask);
+                percentilesRadix<float>(img, pcts, 2, tolerance, results, mask);
+                return std::pair<float, float>(results[0], results[1]);
+            }
+            else
+            {
+                bail("histPercentiles32f: Unsupported image type");
+                return std::pair<float, float>(NAN, NAN); // compiler warning
+            }
+        }
+
+        /**
+         * @brief histPercentiles32f over an ROI of the image, in place (no copy).
+         * @param img
+         * @param roi Must be inside the image.
+         * @param lowPct Percentile to compute, 0 to 100
+         * @param highPct Percentile to compute, 0 to 100
+         * @param tolerance Allowed relative error, 0 for exact.
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         * @return
+         */
+        std::pair<float, float> histPercentiles32f(cv::Mat& img, const cv::Rect& roi, float lowPct, float highPct, float tolerance, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            return histPercentiles32f(imgRoi, lowPct, highPct, tolerance, mask.empty() ? mask : mask(roi));
+        }
+
+        /**
+         * @brief Wrapper to handle image types and convert results to pair of float.
+         * @param img
+         * @param lowPct Percentile to compute, 0 to 100
+         * @param highPct Percentile to compute, 0 to 100
+         * @param mask Optional 8U mask, same size as img.
+         * @return NAN if there are no values (empty image, or the mask excludes everything).
+         */
+        std::pair<float, float> histPercentiles(cv::Mat& img, float lowPct, float highPct, const cv::Mat& mask)
+        {
+            if (img.type() == CV_32F)
+            {
+                return histPercentiles32f(img, lowPct, highPct, 0.0f, mask);
+            }
+            else if ((img.type() == CV_8U) || (img.type() == CV_16U) || (img.type() == CV_16S) || (img.type() == CV_32S))
+            {
+                // not through histPercentilesInt, so no values stays NAN
+                static thread_local std::vector<float> pcts(2);
+                static thread_local std::vector<float> results;
+                pcts[0] = lowPct;
+                pcts[1] = highPct;
+                histPercentiles(img, pcts, results, mask);
+                return std::pair<float, float>(results[0], results[1]);
+            }
+            else
+            {
+                bail("histPercentiles: Unsupported image type");
+                return std::pair<float, float>(NAN, NAN); // compiler warning
+            }
+        }
+
+        /**
+         * @brief Two percentiles over an ROI of the image, in place (no copy), see histPercentiles.
+         * @param img
+         * @param roi Must be inside the image.
+         * @param lowPct Percentile to compute, 0 to 100
+         * @param highPct Percentile to compute, 0 to 100
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         * @return
+         */
+        std::pair<float, float> histPercentiles(cv::Mat& img, const cv::Rect& roi, float lowPct, float highPct, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            return histPercentiles(imgRoi, lowPct, highPct, mask.empty() ? mask : mask(roi));
+        }
+    }
+}
@@ -0,0 +1,780 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+#include <limits>
+#include <vector>
+#include <array>
+#include <type_traits>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+#include "ParallelUtil.h"
+#include "MiscUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Partial stats over a stripe of rows, mergeable in any grouping.
+         * Mean and M2 (sum of squared deviations) are kept instead of sum of squares so the merge
+         * is numerically stable (Chan et al).
+         */
+        struct StatsPartial
+        {
+            int64_t count = 0;
+            int64_t nonzeroCount = 0;
+            double sum = 0.0;
+            double mean = 0.0;
+            double m2 = 0.0;
+            float minVal = FLT_MAX;
+            float maxVal = -FLT_MAX;
+
+            void merge(const StatsPartial& other)
+            {
+                if (other.count == 0)
+                {
+                    return;
+                }
+
+                if (count == 0)
+                {
+                    *this = other;
+                    return;
+                }
+
+                int64_t n = count + other.count;
+                double delta = other.mean - mean;
+                mean += delta * other.count / n;
+                m2 += other.m2 + delta * delta * ((double)count * other.count / n);
+                count = n;
+                nonzeroCount += other.nonzeroCount;
+                sum += other.sum;
+                minVal = std::min(minVal, other.minVal);
+                maxVal = std::max(maxVal, other.maxVal);
+            }
+        };
+
+        typedef std::array<StatsPartial, ImageStats::MaxChannels> StatsPartials;
+
+        /**
+         * @brief Find a good (non-NAN, unmasked) value per channel to shift by, or NAN if a channel has none in these rows.
+         */
+        template <typename T, int CN, bool HasMask>
+        static void findStatsShift(const cv::Mat& img, const cv::Mat& mask, int r0, int r1, double* shift)
+        {
+            int foundCount = 0;
+
+            for (int c = 0; c < CN; c++)
+            {
+                shift[c] = NAN;
+            }
+
+            for (int y = r0; (y < r1) && (foundCount < CN); y++)
+            {
+                const T* p = img.ptr<T>(y);
+                const uint8_t* m = HasMask ? mask.ptr<uint8_t>(y) : nullptr;
+
+                for (int x = 0; (x < img.cols) && (foundCount < CN); x++)
+                {
+                    if (HasMask && !m[x])
+                    {
+                        continue;
+                    }
+
+                    for (int c = 0; c < CN; c++)
+                    {
+                        double v = (double)p[x * CN + c];
+
+                        if (std::isnan(shift[c]) && !std::isnan(v))
+                        {
+                            shift[c] = v;
+                            foundCount++;
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Start values for a min/max accumulator of type T, so that any value (or +-INF) replaces them.
+         */
+        template <typename T>
+        static T minMaxStartLow()
+        {
+            return std::is_floating_point<T>::value ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+        }
+
+        template <typename T>
+        static T minMaxStartHigh()
+        {
+            return std::is_floating_point<T>::value ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+        }
+
+        /**
+         * @brief Single pass over a stripe of rows, accumulating each channel separately.
+         * Integer types up to 16 bits keep exact 64-bit integer sums. 32S, 32F and 64F accumulate in double, with values
+         * shifted by the first good value in the stripe before squaring, which keeps the sum of squares from cancelling
+         * badly when the mean is large relative to the spread. NAN is skipped.
+         * Without a mask the inner loop has no branches so the compiler can vectorize it.
+         */
+        template <typename T, int CN, bool HasMask>
+        static void accumulateStats(const cv::Mat& img, const cv::Mat& mask, int r0, int r1, StatsPartials& parts)
+        {
+            constexpr bool isSmallInt = std::is_integral_v<T> && (sizeof(T) <= 2);
+            typedef std::conditional_t<isSmallInt, int64_t, double> SumType;
+            typedef std::conditional_t<isSmallInt, uint64_t, double> SumSqType;
+
+            double shift[CN];
+
+            if constexpr (isSmallInt)
+            {
+                std::fill(shift, shift + CN, 0.0);
+            }
+            else
+            {
+                findStatsShift<T, CN, HasMask>(img, mask, r0, r1, shift);
+            }
+
+            SumType sum[CN] = {};
+            SumSqType sumSq[CN] = {};
+            int64_t n[CN] = {};
+            int64_t nonzero[CN] = {};
+            T minVal[CN];
+            T maxVal[CN];
+            std::fill(minVal, minVal + CN, minMaxStartLow<T>());
+            std::fill(maxVal, maxVal + CN, minMaxStartHigh<T>());
+            int cols = img.cols;
+
+            for (int y = r0; y < r1; y++)
+            {
+                const T* p = img.ptr<T>(y);
+                const uint8_t* m = HasMask ? mask.ptr<uint8_t>(y) : nullptr;
+
+                for (int x = 0; x < cols; x++)
+                {
+                    if constexpr (HasMask)
+                    {
+                        if (!m[x])
+                        {
+                            continue;
+                        }
+                    }
+
+                    for (int c = 0; c < CN; c++)
+                    {
+                        T v = p[x * CN + c];
+
+                        if constexpr (isSmallInt)
+                        {
+                            sum[c] += v;
+                            sumSq[c] += (uint64_t)((int64_t)v * v);
+                            n[c]++;
+                            nonzero[c] += (v != 0);
+                            minVal[c] = std::min(minVal[c], v);
+                            maxVal[c] = std::max(maxVal[c], v);
+                        }
+                        else
+                        {
+                            bool isGood = (v == v); // false only for nan
+                            double d = isGood ? (double)v - shift[c] : 0.0;
+                            sum[c] += d;
+                            sumSq[c] += d * d;
+                            n[c] += isGood;
+                            nonzero[c] += isGood & (v != 0);
+
+                            // comparisons are false for nan so these skip it
+                            minVal[c] = (v < minVal[c]) ? v : minVal[c];
+                            maxVal[c] = (v > maxVal[c]) ? v : maxVal[c];
+                        }
+                    }
+                }
+            }
+
+            for (int c = 0; c < CN; c++)
+            {
+                StatsPartial& part = parts[c];
+
+                if (n[c] > 0)
+                {
+                    double dsum = (double)sum[c];
+                    part.count = n[c];
+                    part.nonzeroCount = nonzero[c];
+                    part.sum = dsum + shift[c] * n[c];
+                    part.mean = shift[c] + dsum / n[c];
+                    part.m2 = std::max(0.0, (double)sumSq[c] - dsum * dsum / n[c]);
+                    part.minVal = (float)minVal[c];
+                    part.maxVal = (float)maxVal[c];
+                }
+            }
+        }
+
+        template <typename T, int CN>
+        static void computeStatsParallel(const cv::Mat& img, const cv::Mat& mask, StatsPartials& total)
+        {
+            int stripeCount = ParallelUtil::getStripeCount(img.rows, img.cols * CN);
+            std::vector<StatsPartials> parts(stripeCount);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int s, int r0, int r1)
+            {
+                if (mask.empty())
+                {
+                    accumulateStats<T, CN, false>(img, mask, r0, r1, parts[s]);
+                }
+                else
+                {
+                    accumulateStats<T, CN, true>(img, mask, r0, r1, parts[s]);
+                }
+            });
+
+            // merge in stripe order so results do not depend on scheduling
+            for (const StatsPartials& part : parts)
+            {
+                for (int c = 0; c < CN; c++)
+                {
+                    total[c].merge(part[c]);
+                }
+            }
+        }
+
+        template <typename T>
+        static void computeStatsParallel(const cv::Mat& img, const cv::Mat& mask, StatsPartials& total)
+        {
+            switch (img.channels())
+            {
+            case 1:
+                computeStatsParallel<T, 1>(img, mask, total);
+                break;
+            case 2:
+                computeStatsParallel<T, 2>(img, mask, total);
+                break;
+            case 3:
+                computeStatsParallel<T, 3>(img, mask, total);
+                break;
+            case 4:
+                computeStatsParallel<T, 4>(img, mask, total);
+                break;
+            default:
+                bail("computeStats: Unsupported channel count");
+            }
+        }
+
+        static void copyPartialToStats(const StatsPartial& part, ChannelStats& stats)
+        {
+            stats.count = part.count;
+            stats.nonzeroCount = part.nonzeroCount;
+
+            if (part.count > 0)
+            {
+                stats.sum = part.sum;
+                stats.minVal = part.minVal;
+                stats.maxVal = part.maxVal;
+                stats.mean = part.mean;
+                stats.variance = part.m2 / part.count;
+            }
+            else
+            {
+                stats.sum = 0;
+                stats.minVal = NAN;
+                stats.maxVal = NAN;
+                stats.mean = NAN;
+                stats.variance = NAN;
+            }
+        }
+
+        /**
+         * @brief Compute count, nonzero count, sum, min, max, mean and variance per channel in a single pass over the image.
+         * Rows are split into stripes that are processed in parallel and then merged.
+         * Any depth except 16F is handled, with 1 to 4 channels.
+         * NAN values are skipped (not counted) like imgMinMax does. If there are no good values then min and max are NAN.
+         * @param img
+         * @param mask Optional 8U mask, same size as img. Only pixels where the mask is nonzero are included.
+         * @return
+         */
+        ImageStats computeStats(cv::Mat& img, const cv::Mat& mask)
+        {
+            ImageStats stats;
+            stats.type = img.type();
+            stats.width = img.cols;
+            stats.height = img.rows;
+            stats.channels = img.channels();
+
+            if (!mask.empty())
+            {
+                CV_Assert(mask.type() == CV_8U && mask.rows == img.rows && mask.cols == img.cols);
+            }
+
+            StatsPartials parts;
+
+            switch (img.depth())
+            {
+            case CV_8U:
+                computeStatsParallel<uint8_t>(img, mask, parts);
+                break;
+            case CV_8S:
+                computeStatsParallel<int8_t>(img, mask, parts);
+                break;
+            case CV_16U:
+                computeStatsParallel<uint16_t>(img, mask, parts);
+                break;
+            case CV_16S:
+                computeStatsParallel<int16_t>(img, mask, parts);
+                break;
+            case CV_32S:
+                computeStatsParallel<int32_t>(img, mask, parts);
+                break;
+            case CV_32F:
+                computeStatsParallel<float>(img, mask, parts);
+                break;
+            case CV_64F:
+                computeStatsParallel<double>(img, mask, parts);
+                break;
+            default:
+                bail("computeStats: Unsupported image type");
+            }
+
+            // all channels combined
+            StatsPartial all;
+
+            for (int c = 0; c < stats.channels; c++)
+            {
+                copyPartialToStats(parts[c], stats.channelStats[c]);
+                all.merge(parts[c]);
+            }
+
+            ChannelStats allStats;
+            copyPartialToStats(all, allStats);
+            stats.count = allStats.count;
+            stats.nonzeroCount = allStats.nonzeroCount;
+            stats.sum = allStats.sum;
+            stats.minVal = allStats.minVal;
+            stats.maxVal = allStats.maxVal;
+            stats.mean = allStats.mean;
+            stats.variance = allStats.variance;
+
+            return stats;
+        }
+
+        ImageStats computeStats(cv::Mat& img)
+        {
+            return computeStats(img, cv::Mat());
+        }
+
+        /**
+         * @brief Compute stats on an ROI of the image, in place (no copy).
+         * @param img
+         * @param roi Must be inside the image.
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         * @return Stats, with width and height of the roi.
+         */
+        ImageStats computeStats(cv::Mat& img, const cv::Rect& roi, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            cv::Mat imgRoi = img(roi);
+            return computeStats(imgRoi, mask.empty() ? mask : mask(roi));
+        }
+
+        /**
+         * @brief Partial min/max over a stripe of rows, with counts of NAN and +-INF values.
+         * Doubles so 32S and 64F come through exactly.
+         */
+        struct MinMaxPartial
+        {
+            double minVal = INFINITY;
+            double maxVal = -INFINITY;
+            int64_t nanCount = 0;
+            int64_t infCount = 0;
+
+            void merge(const MinMaxPartial& other)
+            {
+                minVal = std::min(minVal, other.minVal);
+                maxVal = std::max(maxVal, other.maxVal);
+                nanCount += other.nanCount;
+                infCount += other.infCount;
+            }
+        };
+
+        /**
+         * @brief Min/max over n values, no locations.
+         * Keeps independent lanes in the native type with branch-free selects so the compiler can vectorize it. For
+         * floats the selects have the same semantics as SSE/NEON min/max (the second operand wins if either is NAN), so
+         * NAN is dropped for free, and NAN and +-INF are counted in the same pass.
+         */
+        template <typename T>
+        static void minMaxValues(const T* p, int n, T& minVal, T& maxVal, int64_t& nanCount, int64_t& infCount)
+        {
+            const int laneCount = 8;
+            T mn[laneCount];
+            T mx[laneCount];
+            int nans[laneCount] = {};
+            int infs[laneCount] = {};
+            std::fill(mn, mn + laneCount, minVal);
+            std::fill(mx, mx + laneCount, maxVal);
+            int x = 0;
+
+            for (; x + laneCount <= n; x += laneCount)
+            {
+                for (int k = 0; k < laneCount; k++)
+                {
+                    T v = p[x + k];
+                    mn[k] = (v < mn[k]) ? v : mn[k];
+                    mx[k] = (v > mx[k]) ? v : mx[k];
+
+                    if constexpr (std::is_floating_point<T>::value)
+                    {
+                        nans[k] += (v != v);
+                        infs[k] += (std::abs(v) == std::numeric_limits<T>::infinity());
+                    }
+                }
+            }
+
+            for (; x < n; x++)
+            {
+                T v = p[x];
+                mn[0] = (v < mn[0]) ? v : mn[0];
+                mx[0] = (v > mx[0]) ? v : mx[0];
+
+                if constexpr (std::is_floating_point<T>::value)
+                {
+                    nans[0] += (v != v);
+                    infs[0] += (std::abs(v) == std::numeric_limits<T>::infinity());
+                }
+            }
+
+            for (int k = 0; k < laneCount; k++)
+            {
+                minVal = std::min(minVal, mn[k]);
+                maxVal = std::max(maxVal, mx[k]);
+                nanCount += nans[k];
+                infCount += infs[k];
+            }
+        }
+
+        template <typename T>
+        static void minMaxParallel(const cv::Mat& img, MinMaxPartial& total)
+        {
+            int n = img.cols * img.channels();
+            int stripeCount = ParallelUtil::getStripeCount(img.rows, n);
+            std::vector<MinMaxPartial> parts(stripeCount);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int s, int r0, int r1)
+            {
+                T mn = minMaxStartLow<T>();
+                T mx = minMaxStartHigh<T>();
+                MinMaxPartial& part = parts[s];
+
+                for (int y = r0; y < r1; y++)
+                {
+                    minMaxValues<T>(img.ptr<T>(y), n, mn, mx, part.nanCount, part.infCount);
+                }
+
+                part.minVal = (double)mn;
+                part.maxVal = (double)mx;
+            });
+
+            for (const MinMaxPartial& part : parts)
+            {
+                total.merge(part);
+            }
+        }
+
+        /**
+         * @brief Find min and max in image, no locations. Any depth except 16F, any channel count (all channels together).
+         * This is the cheap reduction, a single row-parallel vectorizable pass, use it instead of cv::minMaxLoc when the
+         * locations aren't needed. NAN is skipped, since that is the normal case for masked images and minMaxLoc does not
+         * reliably skip it on all platforms.
+         * @param img
+         * @param minVal Output, NAN if there are no non-NAN values.
+         * @param maxVal Output, NAN if there are no non-NAN values.
+         * @param nanCount Optional output, number of NAN values (always 0 for integer images).
+         * @param infCount Optional output, number of +-INF values (always 0 for integer images).
+         */
+        void imgMinMax(const cv::Mat& img, double& minVal, double& maxVal, int64_t* nanCount, int64_t* infCount)
+        {
+            MinMaxPartial total;
+
+            switch (img.depth())
+            {
+            case CV_8U:
+                minMaxParallel<uint8_t>(img, total);
+                break;
+            case CV_8S:
+                minMaxParallel<int8_t>(img, total);
+                break;
+            case CV_16U:
+                minMaxParallel<uint16_t>(img, total);
+                break;
+            case CV_16S:
+                minMaxParallel<int16_t>(img, total);
+                break;
+            case CV_32S:
+                minMaxParallel<int32_t>(img, total);
+                break;
+            case CV_32F:
+                minMaxParallel<float>(img, total);
+                break;
+            case CV_64F:
+                minMaxParallel<double>(img, total);
+                break;
+            default:
+                bail("imgMinMax: Unsupported image type");
+            }
+
+            if (nanCount != nullptr)
+            {
+                *nanCount = total.nanCount;
+            }
+
+            if (infCount != nullptr)
+            {
+                *infCount = total.infCount;
+            }
+
+            // handle all nan (or empty)
+            if (total.nanCount == (int64_t)img.total() * img.channels())
+            {
+                minVal = maxVal = NAN;
+                return;
+            }
+
+            minVal = total.minVal;
+            maxVal = total.maxVal;
+        }
+
+        /**
+         * @brief Find min and max in image, and count NAN and +-INF, see imgMinMax(img, minVal, maxVal, nanCount, infCount).
+         * @return min and max, both NAN if there are no non-NAN values.
+         */
+        std::pair<float, float> imgMinMax(cv::Mat& img, int64_t& nanCount, int64_t& infCount)
+        {
+            double minVal, maxVal;
+            imgMinMax(img, minVal, maxVal, &nanCount, &infCount);
+            return std::pair<float, float>((float)minVal, (float)maxVal);
+        }
+
+        /**
+         * @brief Find min and max in image, any type of image but returns floats.
+         * NAN is skipped, see imgMinMax(img, minVal, maxVal, nanCount, infCount).
+         * @param img
+         * @return min and max, both NAN if there are no non-NAN values.
+         */
+        std::pair<float, float> imgMinMax(cv::Mat& img)
+        {
+            double minVal, maxVal;
+            imgMinMax(img, minVal, maxVal);
+            return std::pair<float, float>((float)minVal, (float)maxVal);
+        }
+
+        /**
+         * @brief Partial min/max with locations over a stripe of rows. Locations are -1 until a value is found.
+         */
+        struct MinMaxLocPartial
+        {
+            double minVal = INFINITY;
+            double maxVal = -INFINITY;
+            cv::Point minLoc = cv::Point(-1, -1);
+            cv::Point maxLoc = cv::Point(-1, -1);
+
+            /**
+             * @brief Merge a later stripe into this one. Ties keep the earlier location, so the result is the first
+             * occurrence in row-major order like cv::minMaxLoc.
+             */
+            void merge(const MinMaxLocPartial& other)
+            {
+                if (other.minLoc.x >= 0 && (minLoc.x < 0 || other.minVal < minVal))
+                {
+                    minVal = other.minVal;
+                    minLoc = other.minLoc;
+                }
+
+                if (other.maxLoc.x >= 0 && (maxLoc.x < 0 || other.maxVal > maxVal))
+                {
+                    maxVal = other.maxVal;
+                    maxLoc = other.maxLoc;
+                }
+            }
+        };
+
+        /**
+         * @brief Min/max with locations over a stripe of single-channel rows, NAN skipped.
+         * Without a mask each row is reduced with the vectorized minMaxValues(), and only a row that improves on the
+         * stripe's min or max is scanned again to find the column, so the location costs almost nothing.
+         */
+        template <typename T>
+        static void minMaxLocRows(const cv::Mat& img, const cv::Mat& mask, int r0, int r1, MinMaxLocPartial& part)
+        {
+            T bestMin = minMaxStartLow<T>();
+            T bestMax = minMaxStartHigh<T>();
+            int64_t nanCount = 0;
+            int64_t infCount = 0;
+
+            for (int y = r0; y < r1; y++)
+            {
+                const T* p = img.ptr<T>(y);
+
+                if (mask.empty())
+                {
+                    T rowMin = minMaxStartLow<T>();
+                    T rowMax = minMaxStartHigh<T>();
+                    minMaxValues<T>(p, img.cols, rowMin, rowMax, nanCount, infCount);
+
+                    // <= on the first hit so that a row of all start values (e.g. 255 in 8U) still gets a location
+                    if (rowMin < bestMin || (part.minLoc.x < 0 && rowMin == bestMin))
+                    {
+                        int x = (int)(std::find(p, p + img.cols, rowMin) - p);
+
+                        if (x < img.cols)
+                        {
+                            bestMin = rowMin;
+                            part.minLoc = cv::Point(x, y);
+                        }
+                    }
+
+                    if (rowMax > bestMax || (part.maxLoc.x < 0 && rowMax == bestMax))
+                    {
+                        int x = (int)(std::find(p, p + img.cols, rowMax) - p);
+
+                        if (x < img.cols)
+                        {
+                            bestMax = rowMax;
+                            part.maxLoc = cv::Point(x, y);
+                        }
+                    }
+                }
+                else
+                {
+                    const uint8_t* m = mask.ptr<uint8_t>(y);
+
+                    for (int x = 0; x < img.cols; x++)
+                    {
+                        T v = p[x];
+
+                        if (m[x] == 0 || v != v)
+                        {
+                            continue;
+                        }
+
+                        if (v < bestMin || part.minLoc.x < 0)
+                        {
+                            bestMin = v;
+                            part.minLoc = cv::Point(x, y);
+                        }
+
+                        if (v > bestMax || part.maxLoc.x < 0)
+                        {
+                            bestMax = v;
+                            part.maxLoc = cv::Point(x, y);
+                        }
+                    }
+                }
+            }
+
+            part.minVal = (double)bestMin;
+            part.maxVal = (double)bestMax;
+        }
+
+        template <typename T>
+        static MinMaxLocPartial minMaxLocParallel(const cv::Mat& img, const cv::Mat& mask)
+        {
+            int stripeCount = ParallelUtil::getStripeCount(img.rows, img.cols);
+            std::vector<MinMaxLocPartial> parts(stripeCount);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int s, int r0, int r1)
+            {
+                minMaxLocRows<T>(img, mask, r0, r1, parts[s]);
+            });
+
+            // stripe order, so ties go to the first occurrence
+            MinMaxLocPartial total;
+
+            for (const MinMaxLocPartial& part : parts)
+            {
+                total.merge(part);
+            }
+
+            return total;
+        }
+
+        /**
+         * @brief Find min and max in a single-channel image and where they are.
+         * Row-parallel like imgMinMax(), but use that one if the locations aren't needed.
+         * NAN is skipped. Ties go to the first occurrence in row-major order, like cv::minMaxLoc.
+         * @param img Single channel, any depth except 16F.
+         * @param mask Optional 8U mask, same size as img. Only pixels where the mask is nonzero are included.
+         * @return Min, max and locations. If there are no included non-NAN values then min and max are NAN and the locations are (-1, -1).
+         */
+        MinMaxLoc imgMinMaxLoc(const cv::Mat& img, const cv::Mat& mask)
+        {
+            CV_Assert(img.channels() == 1);
+
+            if (!mask.empty())
+            {
+                CV_Assert(mask.type() == CV_8U && mask.rows == img.rows && mask.cols == img.cols);
+            }
+
+            MinMaxLocPartial total;
+
+            switch (img.depth())
+            {
+            case CV_8U:
+                total = minMaxLocParallel<uint8_t>(img, mask);
+                break;
+            case CV_8S:
+                total = minMaxLocParallel<int8_t>(img, mask);
+                break;
+            case CV_16U:
+                total = minMaxLocParallel<uint16_t>(img, mask);
+                break;
+            case CV_16S:
+                total = minMaxLocParallel<int16_t>(img, mask);
+                break;
+            case CV_32S:
+                total = minMaxLocParallel<int32_t>(img, mask);
+                break;
+            case CV_32F:
+                total = minMaxLocParallel<float>(img, mask);
+                break;
+            case CV_64F:
+                total = minMaxLocParallel<double>(img, mask);
+                break;
+            default:
+                bail("imgMinMaxLoc: Unsupported image type");
+            }
+
+            MinMaxLoc result;
+            result.minLoc = total.minLoc;
+            result.maxLoc = total.maxLoc;
+            result.minVal = (total.minLoc.x < 0) ? NAN : total.minVal;
+            result.maxVal = (total.maxLoc.x < 0) ? NAN : total.maxVal;
+
+            return result;
+        }
+
+        /**
+         * @brief Find min and max and their locations within an ROI of the image, in place (no copy).
+         * @param img
+         * @param roi Must be inside the image.
+         * @param mask Optional 8U mask, same size as img (not the roi).
+         * @return Min, max and locations, locations are in img coordinates (not relative to the roi).
+         */
+        MinMaxLoc imgMinMaxLoc(const cv::Mat& img, const cv::Rect& roi, const cv::Mat& mask)
+        {
+            CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= img.cols && roi.y + roi.height <= img.rows);
+            MinMaxLoc result = imgMinMaxLoc(img(roi), mask.empty() ? mask : mask(roi));
+
+            if (result.minLoc.x >= 0)
+            {
+                result.minLoc += roi.tl();
+                result.maxLoc += roi.tl();
+            }
+
+            return result;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#pragma once
+#include <array>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Stats over one channel of an image.
+         */
+        struct ChannelStats
+        {
+            /**
+             * @brief Number of values that went into the stats (excludes NAN and masked-out pixels).
+             */
+            int64_t count = 0;
+
+            int64_t nonzeroCount = 0;
+            double sum = 0.0;
+            float minVal = 0.0f;
+            float maxVal = 0.0f;
+            double mean = 0.0;
+
+            /**
+             * @brief Population variance (divide by count).
+             */
+            double variance = 0.0;
+        };
+
+        /**
+         * @brief Stats over an image or ROI of an image.
+         * NAN pixels (32F) are skipped, so count can be less than width * height.
+         * The top-level count/sum/min/max/mean/variance are over all channels combined, and channelStats
+         * has the same per channel. For single-channel images these are the same.
+         */
+        struct ImageStats
+        {
+            static constexpr int MaxChannels = 4;
+
+            int type = 0;
+            int width = 0;
+            int height = 0;
+            int channels = 0;
+
+            /**
+             * @brief Number of values that went into the stats (excludes NAN and masked-out pixels).
+             * For multi-channel images this counts each channel value separately.
+             */
+            int64_t count = 0;
+
+            int64_t nonzeroCount = 0;
+            double sum = 0.0;
+            float minVal = 0.0f;
+            float maxVal = 0.0f;
+            double mean = 0.0;
+
+            /**
+             * @brief Population variance (divide by count).
+             */
+            double variance = 0.0;
+
+            /**
+             * @brief Per-channel stats, only the first channels entries are set.
+             */
+            std::array<ChannelStats, MaxChannels> channelStats;
+
+            bool empty()
+            {
+                return width <= 0;
+            }
+        };
+
+        /**
+         * @brief Min and max values of an image and where they first occur, from imgMinMaxLoc().
+         */
+        struct MinMaxLoc
+        {
+            double minVal = 0.0;
+            double maxVal = 0.0;
+
+            /**
+             * @brief (-1, -1) if there were no values.
+             */
+            cv::Point minLoc = cv::Point(-1, -1);
+            cv::Point maxLoc = cv::Point(-1, -1);
+        };
+
+        /**
+         * @brief Count, mean, variance and mode derived from an integer histogram (histInt), see histMoments().
+         */
+        struct HistMoments
+        {
+            int64_t count = 0;
+            double mean = 0.0;
+
+            /**
+             * @brief Population variance (divide by count).
+             */
+            double variance = 0.0;
+
+            /**
+             * @brief Value of the bin with the highest count.
+             */
+            float mode = 0.0f;
+        };
+    }
+}
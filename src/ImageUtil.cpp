@@ -6,6 +6,7 @@
 #include <cmath>
 #include <regex>
 #include <filesystem>
+#include <algorithm>
 
 #include <fmt/core.h>
 #include <opencv2/opencv.hpp>
@@ -15,6 +16,7 @@
 #include "MiscUtil.h"
 #include "StringUtil.h"
 #include "MathUtil.h"
+#include "ParallelUtil.h"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -138,57 +140,6 @@ namespace CppOpenCVUtil
             return std::find(allImageExtensions.begin(), allImageExtensions.end(), ext) != allImageExtensions.end();
         }
 
-        /**
-         * @brief Find min and max in image, any type of image but returns floats.
-         * @param img
-         * @return
-         */
-        std::pair<float, float> imgMinMax(cv::Mat& img)
-        {
-            double minVal, maxVal;
-            cv::Point2i minLoc, maxLoc;
-            cv::minMaxLoc(img, &minVal, &maxVal, &minLoc, &maxLoc);
-            float lowVal = (float)minVal;
-            float highVal = (float)maxVal;
-
-            if (std::isnan(lowVal) || std::isnan(highVal))
-            {
-                // happens on mac os when any nan's in the image
-                if (img.type() != CV_32F)
-                {
-                    bail("minmax gave nan on non-32f image");
-                }
-
-                // my own
-                lowVal = FLT_MAX;
-                highVal = -FLT_MAX;
-
-                for (int r = 0; r < img.rows; r++)
-                {
-                    float* p = img.ptr<float>(r);
-
-                    for (int c = 0; c < img.cols; c++)
-                    {
-                        float val = p[c];
-
-                        if (!std::isnan(val))
-                        {
-                            lowVal = std::min(lowVal, val);
-                            highVal = std::max(highVal, val);
-                        }
-                    }
-                }
-
-                // handle all nan
-                if (highVal < lowVal)
-                {
-                    lowVal = highVal = NAN;
-                }
-            }
-
-            return std::pair<float, float>(lowVal, highVal);
-        }
-
         /**
          * @brief Convert to 8u via convertScaleAbs. Computes
          * @param img
@@ -213,270 +164,324 @@ namespace CppOpenCVUtil
             cv::convertScaleAbs(img, dst, alpha, beta);
         }
 
-        void imgToRgb(cv::Mat& img8u, uint8_t* dst)
+        /**
+         * @brief Map a value to the 0 to 255 range (not yet saturated) with the specified curve.
+         * @param scale 255 / (highVal - lowVal), precomputed.
+         */
+        static inline float toneMapTo8u(float v, float lowVal, float highVal, float scale, ToneCurve curve, float gamma)
         {
-            if (img8u.type() == CV_8U)
+            if (curve == ToneCurve::Linear)
             {
-                // use cvtColor with cv::Mat wrapper around the dst image
-                for (int y = 0; y < img8u.rows; y++)
-                {
-                    for (int x = 0; x < img8u.cols; x++)
-                    {
-                        uint8_t val = img8u.at<uint8_t>(y, x);
-                        int i = (y * img8u.cols + x) * 3;
-                        dst[i] = val;
-                        dst[i + 1] = val;
-                        dst[i + 2] = val;
-                    }
-                }
+                return (v - lowVal) * scale;
+            }
+            else if (curve == ToneCurve::Gamma)
+            {
+                float t = std::clamp((v - lowVal) / (highVal - lowVal), 0.0f, 1.0f);
+                return 255.0f * std::pow(t, gamma);
             }
             else
             {
-                bail("imgToRgb wrong input image type.");
+                return 255.0f * std::log1p(std::max(0.0f, v - lowVal)) / std::log1p(highVal - lowVal);
             }
         }
 
-        std::vector<int> histInt(cv::Mat& img)
+        /**
+         * @brief Build a table that maps values (index plus lutOffset) to 8u with the specified curve.
+         * @param lutSize 256 for 8-bit or 65536 for 16-bit input.
+         */
+        static void buildToneLut(float lowVal, float highVal, ToneCurve curve, float gamma, int lutOffset, int lutSize, std::vector<uint8_t>& lut)
         {
-            std::vector<int> counts;
+            lut.resize(lutSize);
+            float scale = 255.0f / (highVal - lowVal);
 
-            if (img.type() == CV_8U)
+            for (int i = 0; i < lutSize; i++)
             {
-                counts.resize(256);
+                lut[i] = cv::saturate_cast<uint8_t>(toneMapTo8u((float)(i + lutOffset), lowVal, highVal, scale, curve, gamma));
+            }
+        }
 
-                for (int y = 0; y < img.rows; y++)
+        /**
+         * @brief A tone LUT and what it was built for.
+         */
+        struct ToneLutCache
+        {
+            float lowVal = NAN;
+            float highVal = NAN;
+            ToneCurve curve = ToneCurve::Linear;
+            float gamma = 1.0f;
+            int lutOffset = 0;
+            std::vector<uint8_t> lut;
+        };
+
+        /**
+         * @brief Get a tone LUT, only rebuilding it if the range, curve or input type changed.
+         * This is cached per thread since a live viewer converts frame after frame with the same stretch.
+         */
+        static const uint8_t* getToneLut(float lowVal, float highVal, ToneCurve curve, float gamma, int lutOffset, int lutSize)
+        {
+            static thread_local ToneLutCache caches[2]; // 8-bit and 16-bit
+            ToneLutCache& cache = caches[lutSize > 256 ? 1 : 0];
+
+            if ((cache.lowVal != lowVal) || (cache.highVal != highVal) || (cache.curve != curve) || (cache.gamma != gamma)
+                || (cache.lutOffset != lutOffset) || ((int)cache.lut.size() != lutSize))
+            {
+                buildToneLut(lowVal, highVal, curve, gamma, lutOffset, lutSize, cache.lut);
+                cache.lowVal = lowVal;
+                cache.highVal = highVal;
+                cache.curve = curve;
+                cache.gamma = gamma;
+                cache.lutOffset = lutOffset;
+            }
+
+            return cache.lut.data();
+        }
+
+        /**
+         * @brief Stretch to 8u without the absolute value that convertScaleAbs takes, row-parallel.
+         * lowVal maps to 0 and highVal to 255, saturating outside. NAN maps to 0.
+         */
+        template <typename T>
+        static void stretchRowsTo8u(const cv::Mat& img, cv::Mat& dst, float lowVal, float highVal, ToneCurve curve, float gamma)
+        {
+            float scale = 255.0f / (highVal - lowVal);
+            int stripeCount = ParallelUtil::getStripeCount(img.rows, img.cols);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int, int r0, int r1)
+            {
+                for (int y = r0; y < r1; y++)
                 {
-                    uint8_t* ps = img.ptr<uint8_t>(y);
+                    const T* ps = img.ptr<T>(y);
+                    uint8_t* pd = dst.ptr<uint8_t>(y);
 
-                    for (int x = 0; x < img.cols; x++)
+                    if (curve == ToneCurve::Linear)
+                    {
+                        for (int x = 0; x < img.cols; x++)
+                        {
+                            float v = (float)ps[x];
+                            pd[x] = (v == v) ? cv::saturate_cast<uint8_t>((v - lowVal) * scale) : 0;
+                        }
+                    }
+                    else
                     {
-                        counts[ps[x]]++;
+                        for (int x = 0; x < img.cols; x++)
+                        {
+                            float v = (float)ps[x];
+                            pd[x] = (v == v) ? cv::saturate_cast<uint8_t>(toneMapTo8u(v, lowVal, highVal, scale, curve, gamma)) : 0;
+                        }
                     }
                 }
-            }
-            else if (img.type() == CV_16U)
-            {
-                counts.resize(65536);
+            });
+        }
 
-                for (int y = 0; y < img.rows; y++)
+        /**
+         * @brief Apply a 65536-entry 8u LUT to a 16U or 16S image, row-parallel.
+         */
+        template <typename T>
+        static void applyLut16(const cv::Mat& img, cv::Mat& dst, const uint8_t* lut, int lutOffset)
+        {
+            int stripeCount = ParallelUtil::getStripeCount(img.rows, img.cols);
+
+            ParallelUtil::parallelForStripes(img.rows, stripeCount, [&](int, int r0, int r1)
+            {
+                for (int y = r0; y < r1; y++)
                 {
-                    uint16_t* ps = img.ptr<uint16_t>(y);
+                    const T* ps = img.ptr<T>(y);
+                    uint8_t* pd = dst.ptr<uint8_t>(y);
 
                     for (int x = 0; x < img.cols; x++)
                     {
-                        counts[ps[x]]++;
+                        pd[x] = lut[(int)ps[x] - lutOffset];
                     }
                 }
-            }
-            else
-            {
-                bail("histInt: Type not handled yet.");
-            }
-
-            return counts;
+            });
         }
 
         /**
-         * @brief Uniform hist on any type of image but uses float for bins.
-         * If maxVal <= minVal then this ignores binCount and returns a single bin (at minVal) with count 0.
-         * @param img
-         * @param binCount
-         * @param minVal Bottom of first bin. If NAN then choose a default. Default is 0.
-         * @param maxVal Top of last bin. If NAN then choose a default. Default is max value in image.
-         * @param bins
-         * @param hist
+         * @brief Convert a single-channel image to 8u with a linear, gamma or log curve, without taking an absolute value.
+         * lowVal maps to 0 and highVal to 255, saturating outside, and NAN maps to 0.
+         * 8U always goes through a 256-entry table. 16U and 16S go through a 65536-entry table if useLut.
+         * Tables are cached by range and curve, so curves cost nothing extra per pixel and repeated calls with the same
+         * stretch do not rebuild them. Other types evaluate the curve per pixel.
+         * @param img 8U, 16U, 16S, 32S or 32F.
+         * @param dst
+         * @param lowVal The pixel value in the image to pin to 0 in 8u. If highVal <= lowVal then min and max of the image are used.
+         * @param highVal The pixel value in the image to pin to 255 in 8u.
+         * @param useLut Whether to use a table for 16U and 16S.
+         * @param curve Linear, gamma (output is 255 * t^gamma for t from 0 to 1) or log (of 1 + value - lowVal).
+         * @param gamma Only for ToneCurve::Gamma.
          */
-        void histFloat(cv::Mat& img, int binCount, float& minVal, float& maxVal, vector<float>& bins, vector<int>& hist)
+        void imgTo8u(cv::Mat& img, cv::Mat& dst, float lowVal, float highVal, bool useLut, ToneCurve curve, float gamma)
         {
-            if (std::isnan(minVal))
-            {
-                minVal = 0;
-            }
+            int type = img.type();
 
-            if (std::isnan(maxVal))
+            if (highVal <= lowVal)
             {
+                // range not specified so use min/max
                 std::pair<float, float> minMax = imgMinMax(img);
-                maxVal = minMax.second;
+                lowVal = (float)minMax.first;
+                highVal = (float)minMax.second;
+
+                if (std::isnan(lowVal) || std::isnan(highVal))
+                {
+                    // no good values
+                    dst.create(img.rows, img.cols, CV_8U);
+                    dst.setTo(0);
+                    return;
+                }
+
+                if (highVal <= lowVal)
+                {
+                    // flat, so anything above low is white
+                    highVal = lowVal + 1.0f;
+                }
             }
 
-            // no non-nan values in image
-            if (std::isnan(maxVal))
+            if (type == CV_8U)
             {
-                bins.clear();
-                hist.clear();
+                const uint8_t* lut = getToneLut(lowVal, highVal, curve, gamma, 0, 256);
+                cv::LUT(img, cv::Mat(1, 256, CV_8U, (void*)lut), dst);
                 return;
             }
 
-            if (maxVal <= minVal)
-            {
-                bins.resize(1);
-                bins[0] = minVal;
-                hist.resize(1);
-                hist[0] = 0;
-            }
-            else
+            dst.create(img.rows, img.cols, CV_8U);
+
+            if (useLut && ((type == CV_16U) || (type == CV_16S)))
             {
-                // bins
-                bins.resize(binCount);
-                float binSize = (maxVal - minVal) / binCount;
+                int lutOffset = (type == CV_16S) ? Hist16sOffset : 0;
+                const uint8_t* lut = getToneLut(lowVal, highVal, curve, gamma, lutOffset, 65536);
 
-                for (int i = 0; i < binCount; i++)
+                if (type == CV_16U)
                 {
-                    bins[i] = minVal + i * binSize;
+                    applyLut16<uint16_t>(img, dst, lut, 0);
+                }
+                else
+                {
+                    applyLut16<int16_t>(img, dst, lut, lutOffset);
                 }
-
-                // upper range val is exclusive, but maxVal may be exactly the max value in image, so increase a little
-                // (float epsilon did not work so use a fraction of bin size)
-                maxVal += 0.1f * binSize;
-
-                // hist
-                float range[] = { minVal, maxVal };
-                const float* histRange = { range };
-                bool uniform = true;
-                bool accumulate = false;
-
-                cv::Mat floatHist;
-                cv::Mat mask;
-                cv::calcHist(&img, 1, 0, mask, floatHist, 1, &binCount, &histRange, uniform, accumulate);
-                floatHist.convertTo(hist, CV_32S);
             }
-        }
-
-        void histFloat(cv::Mat& img, int binCount, float minVal, float maxVal, FloatHist& hist)
-        {
-            hist.minVal = minVal;
-            hist.maxVal = maxVal;
-            histFloat(img, binCount, hist.minVal, hist.maxVal, hist.bins, hist.counts);
-        }
-
-        FloatHist histFloat(cv::Mat& img, int binCount, float minVal, float maxVal)
-        {
-            FloatHist hist;
-            hist.minVal = minVal;
-            hist.maxVal = maxVal;
-            histFloat(img, binCount, hist.minVal, hist.maxVal, hist.bins, hist.counts);
-            return hist;
+            else if (type == CV_16U)
+            {
+                stretchRowsTo8u<uint16_t>(img, dst, lowVal, highVal, curve, gamma);
+            }
+            else if (type == CV_16S)
+            {
+                stretchRowsTo8u<int16_t>(img, dst, lowVal, highVal, curve, gamma);
+            }
+            else if (type == CV_32S)
+            {
+                stretchRowsTo8u<int32_t>(img, dst, lowVal, highVal, curve, gamma);
+            }
+            else if (type == CV_32F)
+            {
+                stretchRowsTo8u<float>(img, dst, lowVal, highVal, curve, gamma);
+            }
+            else
+            {
+                bail("imgTo8u: Unsupported image type");
+            }
         }
 
         /**
-         * @brief Compute hist. Bin width is specified by a bit shift for perf.
-         * @param img
-         * @param binShift bit-shift divisor for how wide bins are
-         * @return
+         * @brief Stretch a single-channel image to 8u so that the specified percentiles map to 0 and 255, in as few
+         * passes as possible: one histogram pass (two for exact 32S) to find the percentiles and one pass to write 8u.
+         * Unlike imgTo8u this does not take an absolute value, values below the low percentile go to 0.
+         * @param img 8U, 16U, 16S, 32S or 32F.
+         * @param dst Output 8U image, the same size.
+         * @param lowPct Percentile (0 to 100) to map to 0.
+         * @param highPct Percentile (0 to 100) to map to 255.
+         * @param useLut For 16U and 16S, whether to build a 65536-entry table and look pixels up in it instead of
+         *     doing a multiply-add per pixel. 8U always uses a 256-entry table.
+         * @param tolerance Relative error allowed for 32F percentiles. The default of 0 is exact and takes two histogram
+         *     passes. At Percentile32fCoarseRelError or more they take a single pass, but narrow data far from 0 can then
+         *     land in a single bin and saturate.
          */
-        std::vector<int> histInt(cv::Mat& img, int binShift)
+        void autoContrastTo8u(cv::Mat& img, cv::Mat& dst, float lowPct, float highPct, bool useLut, float tolerance)
         {
-            std::vector<int> counts;
+            std::pair<float, float> lowHigh;
 
-            if (img.type() == CV_8U)
+            if (img.type() == CV_32F)
             {
-                counts.resize(256 >> binShift);
-
-                for (int y = 0; y < img.rows; y++)
-                {
-                    uint8_t* ps = img.ptr<uint8_t>(y);
-
-                    for (int x = 0; x < img.cols; x++)
-                    {
-                        counts[ps[x] >> binShift]++;
-                    }
-                }
+                lowHigh = histPercentiles32f(img, lowPct, highPct, tolerance);
             }
-            else if (img.type() == CV_16U)
+            else
             {
-                counts.resize(65536 >> binShift);
+                lowHigh = histPercentiles(img, lowPct, highPct);
+            }
 
-                for (int y = 0; y < img.rows; y++)
-                {
-                    uint16_t* ps = img.ptr<uint16_t>(y);
+            float lowVal = lowHigh.first;
+            float highVal = lowHigh.second;
 
-                    for (int x = 0; x < img.cols; x++)
-                    {
-                        counts[ps[x] >> binShift]++;
-                    }
-                }
+            if (std::isnan(lowVal))
+            {
+                // no good values
+                dst.create(img.rows, img.cols, CV_8U);
+                dst.setTo(0);
+                return;
             }
-            else
+
+            if (highVal <= lowVal)
             {
-                bail("histInt: Type not handled yet.");
+                // flat, so anything above low is white
+                highVal = lowVal + 1.0f;
             }
 
-            return counts;
+            imgTo8u(img, dst, lowVal, highVal, useLut, ToneCurve::Linear);
         }
 
         /**
-         * @brief Compute two percentiles on 8u or 16u image.
-         * @param img
-         * @param lowPct Percentile to compute, 0 to 100
-         * @param highPct Percentile to compute, 0 to 100
-         * @return
+         * @brief Expand or copy an 8-bit image into a caller-owned RGB or RGBA buffer, e.g. for display upload.
+         * This wraps dst in a cv::Mat and uses cvtColor (or copyTo when no conversion is needed), which are vectorized and
+         * row-parallel, and handle a non-continuous input.
+         * Channel order is passed through as-is, gray is replicated to all three color channels, and alpha is set to 255.
+         * @param img8u 8UC1, 8UC3 or 8UC4.
+         * @param dst Output pixels, at least img8u.rows * dstStride bytes.
+         * @param dstStride Bytes from one dst row to the next. 0 means tightly packed (cols * dstChannels).
+         * @param dstChannels 3 for RGB or 4 for RGBA.
          */
-        std::pair<int, int> histPercentilesInt(cv::Mat& img, float lowPct, float highPct)
+        void imgToRgb(cv::Mat& img8u, uint8_t* dst, size_t dstStride, int dstChannels)
         {
-            std::vector<int> counts;
+            if ((dstChannels != 3) && (dstChannels != 4))
+            {
+                bail("imgToRgb wrong output channel count.");
+            }
 
-            if ((img.type() == CV_8U) || (img.type() == CV_16U))
+            // nothing to write, and an empty source would release the wrapper
+            if (img8u.empty())
             {
-                counts = histInt(img);
-                return std::pair<int, int>(findPercentileInHist(counts, lowPct), findPercentileInHist(counts, highPct));
+                return;
             }
-            else
+
+            if (dstStride == 0)
             {
-                bail("histPercentiles: Unsupported image type");
-                return std::pair<int, int>(0, 0); // compiler warning
+                dstStride = (size_t)img8u.cols * dstChannels;
             }
-        }
 
-        /**
-         * @brief Compute two percentiles on 32f image.
-         * @param img
-         * @param lowPct Percentile to compute, 0 to 100
-         * @param highPct Percentile to compute, 0 to 100
-         * @return
-         */
-        std::pair<float, float> histPercentiles32f(cv::Mat& img, float lowPct, float highPct)
-        {
-            if (img.type() == CV_32F)
+            cv::Mat dstMat(img8u.rows, img8u.cols, CV_MAKETYPE(CV_8U, dstChannels), dst, dstStride);
+            int type = img8u.type();
+
+            if (type == CV_MAKETYPE(CV_8U, dstChannels))
             {
-                vector<float> bins;
-                vector<int> counts;
-                float minVal = NAN;
-                float maxVal = NAN;
-                histFloat(img, 256, minVal, maxVal, bins, counts);
-                int lowIdx = findPercentileInHist(counts, lowPct);
-                int highIdx = findPercentileInHist(counts, highPct);
-                return std::pair<float, float>(bins[lowIdx], bins[highIdx]);
+                img8u.copyTo(dstMat);
             }
-            else
+            else if (type == CV_8U)
             {
-                bail("histPercentiles32f: Unsupported image type");
-                return std::pair<float, float>(NAN, NAN); // compiler warning
+                cv::cvtColor(img8u, dstMat, (dstChannels == 3) ? cv::COLOR_GRAY2RGB : cv::COLOR_GRAY2RGBA);
             }
-        }
-
-        /**
-         * @brief Wrapper to handle image types and convert results to pair of float.
-         * @param img
-         * @param lowPct Percentile to compute, 0 to 100
-         * @param highPct Percentile to compute, 0 to 100
-         * @return
-         */
-        std::pair<float, float> histPercentiles(cv::Mat& img, float lowPct, float highPct)
-        {
-            if ((img.type() == CV_8U) || (img.type() == CV_16U))
+            else if ((type == CV_8UC3) && (dstChannels == 4))
             {
-                std::pair<int, int> t = histPercentilesInt(img, lowPct, highPct);
-                return std::pair<float, float>((float)t.first, (float)t.second);
+                cv::cvtColor(img8u, dstMat, cv::COLOR_RGB2RGBA);
             }
-            else if (img.type() == CV_32F)
+            else if ((type == CV_8UC4) && (dstChannels == 3))
             {
-                return histPercentiles32f(img, lowPct, highPct);
+                cv::cvtColor(img8u, dstMat, cv::COLOR_RGBA2RGB);
             }
             else
             {
-                bail("histPercentiles: Unsupported image type");
-                return std::pair<float, float>(NAN, NAN); // compiler warning
+                bail("imgToRgb wrong input image type.");
             }
+
+            // the output wrapper must not have been reallocated
+            CV_Assert(dstMat.data == dst);
         }
 
         std::string getImageTypeString(int type)
@@ -501,6 +506,10 @@ namespace CppOpenCVUtil
             {
                 return std::string("32S");
             }
+            else if (type == CV_16S)
+            {
+                return std::string("16S");
+            }
             else if (type == CV_8UC3)
             {
                 return std::string("8UC3");
@@ -551,6 +560,10 @@ namespace CppOpenCVUtil
                 {
                     return fmt::format("{}", img.at<int>(pt.y, pt.x));
                 }
+                else if (type == CV_16S)
+                {
+                    return fmt::format("{}", img.at<int16_t>(pt.y, pt.x));
+                }
                 else if (type == CV_32F)
                 {
                     return fmt::format("{:.1f}", img.at<float>(pt.y, pt.x));
@@ -579,45 +592,57 @@ namespace CppOpenCVUtil
         }
 
         /**
-         * @brief Compute some stats on the input image.
-         * This could be a single-pass function but instead right now uses several cv functions.
+         * @brief Compute some stats on the input image using several cv functions, so several passes over the image.
+         * This is the original implementation, kept as a reference for computeStats (the fused single-pass version)
+         * and to benchmark against.
          * @param img
          * @return
          */
-        ImageStats computeStats(cv::Mat& img)
+        ImageStats computeStatsMultiPass(cv::Mat& img)
         {
             ImageStats stats;
             stats.type = img.type();
             stats.width = img.cols;
             stats.height = img.rows;
+            stats.channels = img.channels();
 
             // just skip rgb for now, not really handling that case
             if (img.channels() == 1)
             {
-                if ((img.type() == CV_8U) || (img.type() == CV_16U))
-                {
-                    stats.nonzeroCount = cv::countNonZero(img);
-                }
-                else
-                {
-                    stats.nonzeroCount = 0;
-                }
+                stats.count = img.rows * img.cols;
+                stats.nonzeroCount = cv::countNonZero(img);
 
                 if (!img.empty())
                 {
-                    stats.sum = (float)cv::sum(img)[0];
+                    stats.sum = cv::sum(img)[0];
 
                     double minVal, maxVal;
                     cv::minMaxLoc(img, &minVal, &maxVal);
                     stats.minVal = (float)minVal;
                     stats.maxVal = (float)maxVal;
+
+                    cv::Scalar mean, stdDev;
+                    cv::meanStdDev(img, mean, stdDev);
+                    stats.mean = mean[0];
+                    stats.variance = stdDev[0] * stdDev[0];
                 }
                 else
                 {
                     stats.sum = 0;
                     stats.minVal = NAN;
                     stats.maxVal = NAN;
+                    stats.mean = NAN;
+                    stats.variance = NAN;
                 }
+
+                ChannelStats& cs = stats.channelStats[0];
+                cs.count = stats.count;
+                cs.nonzeroCount = stats.nonzeroCount;
+                cs.sum = stats.sum;
+                cs.minVal = stats.minVal;
+                cs.maxVal = stats.maxVal;
+                cs.mean = stats.mean;
+                cs.variance = stats.variance;
             }
 
             return stats;
@@ -661,6 +686,9 @@ namespace CppOpenCVUtil
          * are supported.
          * This is barely started, probably many more could be done.
          *
+         * 16U, 16S, 32S and 32F to anything but TIFF are stretched to 8u by autoContrastTo8u with exact 1st and 99th
+         * percentiles. There is no absolute value, so negative values below the low percentile go to 0.
+         *
          * @param img
          * @param inputExt File extension, with or without the period.
          * @param dst Output image. This gets set regardless of whether any conversion is done. If no conversion
@@ -675,11 +703,10 @@ namespace CppOpenCVUtil
             int type = img.type();
             cv::Mat tmp;
 
-            // for 16U, 32F, 32S to non-tiff, auto-range to 8u
-            if (((type == CV_16U) || (type == CV_32S) || (type == CV_32F)) && !isTiff)
+            // for 16U, 16S, 32F, 32S to non-tiff, auto-range to 8u
+            if (((type == CV_16U) || (type == CV_16S) || (type == CV_32S) || (type == CV_32F)) && !isTiff)
             {
-                std::pair<float, float> t = ImageUtil::histPercentiles(img, 1.0f, 99.0f);
-                ImageUtil::imgTo8u(img, dst, t.first, t.second);
+                ImageUtil::autoContrastTo8u(img, dst, 1.0f, 99.0f, true, 0.0f);
                 isChanged = true;
             }
             // for 32S to tiff, convert to 32F
@@ -803,90 +830,6 @@ namespace CppOpenCVUtil
             }
         }
 
-        /**
-         * @brief Render the list of images into a single output image (dst) in a grid of rows and colums, per the spec.
-         * Partially by ChatGPT-4.
-         * @param images The images to render. They must all be 8UC1 or 8UC3. These will all be rendered to the aspect ratio of the first image.
-         * @param captions A caption for each image (empty vector or strings for no caption).
-         * @param spec Parameters for how to render.
-         * @param dst Output image.
-         */
-        void renderCollage(const std::vector<cv::Mat>& images, const std::vector<std::string>& captions, const CollageSpec& spec, cv::Mat& dst)
-        {
-            int imgCount = (int)images.size();
-
-            if (imgCount == 0)
-            {
-                return;
-            }
-
-            // setup for text
-            cv::Scalar captionColor = spec.doBlackBackground ? cv::Scalar(255, 255, 255) : cv::Scalar(0, 0, 0);
-            int baseline;
-            int exampleTextHeight = cv::getTextSize(std::string("Foo1"), spec.fontFace, spec.fontScale, 1, &baseline).height;
-            int captionMargin = exampleTextHeight / 2;
-
-            if (!spec.doCaptions)
-            {
-                exampleTextHeight = 0;
-                captionMargin = 0;
-            }
-
-            // assume all images same aspect ratio
-            int imgRows = images[0].rows;
-            int imgCols = images[0].cols;
-
-            // compute dims
-            int fullWidth = spec.imageWidthPx;
-            int totalMarginCol = (spec.colCount + 1) * spec.marginPx;
-            int subImgWidth = (fullWidth - totalMarginCol) / spec.colCount; // width of each small image
-            int rowCount = (imgCount + spec.colCount - 1) / spec.colCount;  // number of rows of images
-            double imgScale = ((double)spec.imageWidthPx - totalMarginCol) / (spec.colCount * imgCols);
-            int subImgHeight = (int)(imgScale * imgRows);
-            int totalTextHeight = 2 * captionMargin + exampleTextHeight;
-            int fullHeight = subImgHeight * rowCount + spec.marginPx * (rowCount + 1) + rowCount * totalTextHeight;
-
-            // create image
-            dst.create(fullHeight, fullWidth, CV_8UC3);
-            dst.setTo(spec.doBlackBackground ? cv::Scalar(0, 0, 0) : cv::Scalar(255, 255, 255));
-
-            // render images and captions
-            for (int i = 0; i < imgCount; i++)
-            {
-                int row = i / spec.colCount;
-                int col = i % spec.colCount;
-                cv::Mat imgScaled;
-                cv::resize(images[i], imgScaled, cv::Size(subImgWidth, subImgHeight));
-
-                int x = col * imgScaled.cols + (col + 1) * spec.marginPx;
-                int y = row * imgScaled.rows + (row + 1) * spec.marginPx + row * totalTextHeight;
-                cv::Rect roi(x, y, imgScaled.cols, imgScaled.rows);
-
-                if (imgScaled.type() == CV_8UC1)
-                {
-                    cv::cvtColor(imgScaled, imgScaled, cv::COLOR_GRAY2RGB);
-                }
-
-                imgScaled.copyTo(dst(roi));
-
-                if (spec.doCaptions && !captions.empty() && !captions[i].empty())
-                {
-                    std::string s = captions[i];
-                    cv::Size textSize = cv::getTextSize(s, spec.fontFace, spec.fontScale, 1, &baseline);
-
-                    // clip string to fit (this is not efficient but I'm not sure how else to do it)
-                    while (textSize.width >= subImgWidth)
-                    {
-                        s = s.substr(0, s.size() - 1);
-                        textSize = cv::getTextSize(s, spec.fontFace, spec.fontScale, 1, &baseline);
-                    }
-
-                    cv::Point textOrg(x + (imgScaled.cols - textSize.width) / 2, y + imgScaled.rows + textSize.height + captionMargin);
-                    cv::putText(dst, s, textOrg, spec.fontFace, spec.fontScale, captionColor, 1, cv::LINE_AA);
-                }
-            }
-        }
-
         /**
          * @brief Create a profile (row or col sums) on input image.
          * @param img
@@ -5,7 +5,12 @@
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include "FloatHist.h"
+#include "QuantileSketch.h"
 #include "CollageSpec.h"
+#include "ImageStats.h"
+#include "StreamStats.h"
+#include "StripReader.h"
+#include "StripWriter.h"
 
 namespace CppOpenCVUtil
 {
@@ -13,38 +18,48 @@ namespace CppOpenCVUtil
 
     namespace ImageUtil
     {
-        /**
-         * @brief Stats over an image or ROI of an image.
-         */
-        struct ImageStats
-        {
-            int type = 0;
-            int width = 0;
-            int height = 0;
-            int nonzeroCount = 0;
-            float sum = 0.0f;
-            float minVal = 0.0f;
-            float maxVal = 0.0f;
-
-            bool empty()
-            {
-                return width <= 0;
-            }
-        };
-
         void init();
         bool convertAfterLoad(cv::Mat& img, const std::string& ext, cv::Mat& dst);
         bool convertForSave(cv::Mat& img, const std::string& ext, cv::Mat& dst);
 
-        std::vector<int> histInt(cv::Mat& img);
-        std::vector<int> histInt(cv::Mat& img, int binShift);
-        FloatHist histFloat(cv::Mat& img, int binCount, float minVal, float maxVal);
-        void histFloat(cv::Mat& img, int binCount, float minVal, float maxVal, FloatHist& hist);
-        void histFloat(cv::Mat& img, int binCount, float& minVal, float& maxVal, std::vector<float>& bins, std::vector<int>& hist);
+        std::pair<float, float> imgMinMax(cv::Mat& img);
+        std::pair<float, float> imgMinMax(cv::Mat& img, int64_t& nanCount, int64_t& infCount);
+        void imgMinMax(const cv::Mat& img, double& minVal, double& maxVal, int64_t* nanCount = nullptr, int64_t* infCount = nullptr);
+        MinMaxLoc imgMinMaxLoc(const cv::Mat& img, const cv::Mat& mask = cv::Mat());
+        MinMaxLoc imgMinMaxLoc(const cv::Mat& img, const cv::Rect& roi, const cv::Mat& mask = cv::Mat());
 
-        std::pair<int, int> histPercentilesInt(cv::Mat& img, float lowPct, float highPct);
-        std::pair<float, float> histPercentiles32f(cv::Mat& img, float lowPct, float highPct);
-        std::pair<float, float> histPercentiles(cv::Mat& img, float lowPct, float highPct);
+        /**
+         * @brief Value of bin 0 in histInt on 16S images.
+         */
+        const int Hist16sOffset = -32768;
+
+        std::vector<int> histInt(cv::Mat& img, const cv::Mat& mask = cv::Mat());
+        std::vector<int> histInt(cv::Mat& img, int binShift, const cv::Mat& mask = cv::Mat());
+        void histInt(cv::Mat& img, std::vector<int>& counts, const cv::Mat& mask = cv::Mat());
+        void histInt(cv::Mat& img, int binShift, std::vector<int>& counts, const cv::Mat& mask = cv::Mat());
+        void histInt(cv::Mat& img, const cv::Rect& roi, int binShift, std::vector<int>& counts, const cv::Mat& mask = cv::Mat());
+        void histIntAdaptive(cv::Mat& img, int maxBinCount, std::vector<int>& counts, int& offset, int& binShift, const cv::Mat& mask = cv::Mat());
+        void histIntAdaptive(cv::Mat& img, const cv::Rect& roi, int maxBinCount, std::vector<int>& counts, int& offset, int& binShift, const cv::Mat& mask = cv::Mat());
+        void histCumulative(const std::vector<int>& counts, std::vector<int64_t>& cumCounts);
+        float histPercentileFromCumulative(const std::vector<int64_t>& cumCounts, float pct, int offset = 0, int binShift = 0);
+        HistMoments histMoments(const std::vector<int>& counts, int offset = 0, int binShift = 0);
+        FloatHist histFloat(cv::Mat& img, int binCount, float minVal, float maxVal, const cv::Mat& mask = cv::Mat());
+        void histFloat(cv::Mat& img, int binCount, float minVal, float maxVal, FloatHist& hist, const cv::Mat& mask = cv::Mat());
+        void histFloat(cv::Mat& img, const cv::Rect& roi, int binCount, float minVal, float maxVal, FloatHist& hist, const cv::Mat& mask = cv::Mat());
+        void histFloat(cv::Mat& img, int binCount, float& minVal, float& maxVal, std::vector<float>& bins, std::vector<int>& hist, const cv::Mat& mask = cv::Mat());
+        void histFloat(cv::Mat& img, const cv::Rect& roi, int binCount, float& minVal, float& maxVal, std::vector<float>& bins, std::vector<int>& hist, const cv::Mat& mask = cv::Mat());
+        QuantileSketch sketchImage(cv::Mat& img, float compression = 100.0f, const cv::Mat& mask = cv::Mat());
+        void sketchImage(cv::Mat& img, QuantileSketch& sketch, const cv::Mat& mask = cv::Mat());
+
+        std::pair<int, int> histPercentilesInt(cv::Mat& img, float lowPct, float highPct, const cv::Mat& mask = cv::Mat());
+        std::pair<int, int> histPercentilesInt(cv::Mat& img, const cv::Rect& roi, float lowPct, float highPct, const cv::Mat& mask = cv::Mat());
+        std::pair<float, float> histPercentiles32f(cv::Mat& img, float lowPct, float highPct, float tolerance = 0.0f, const cv::Mat& mask = cv::Mat());
+        std::pair<float, float> histPercentiles32f(cv::Mat& img, const cv::Rect& roi, float lowPct, float highPct, float tolerance = 0.0f, const cv::Mat& mask = cv::Mat());
+        std::pair<float, float> histPercentiles(cv::Mat& img, float lowPct, float highPct, const cv::Mat& mask = cv::Mat());
+        std::pair<float, float> histPercentiles(cv::Mat& img, const cv::Rect& roi, float lowPct, float highPct, const cv::Mat& mask = cv::Mat());
+        std::vector<float> histPercentiles(cv::Mat& img, const std::vector<float>& pcts, const cv::Mat& mask = cv::Mat());
+        void histPercentiles(cv::Mat& img, const std::vector<float>& pcts, std::vector<float>& results, const cv::Mat& mask = cv::Mat());
+        void histPercentiles(cv::Mat& img, const cv::Rect& roi, const std::vector<float>& pcts, std::vector<float>& results, const cv::Mat& mask = cv::Mat());
 
         std::string getImageTypeString(int type);
         std::string getImageTypeString(cv::Mat& img);
@@ -52,9 +67,24 @@ namespace CppOpenCVUtil
         std::string getPixelValueString(cv::Mat& img, cv::Point2i pt);
         void printMatInfo(cv::Mat& mat);
 
+        /**
+         * @brief Curve to apply when converting to 8u.
+         */
+        enum class ToneCurve
+        {
+            Linear,
+            Gamma,
+            Log
+        };
+
         void imgTo8u(cv::Mat& img, cv::Mat& dst, float lowVal = 0.0f, float highVal = 0.0f);
-        void imgToRgb(cv::Mat& img8u, uint8_t* dst);
+        void imgTo8u(cv::Mat& img, cv::Mat& dst, float lowVal, float highVal, bool useLut, ToneCurve curve = ToneCurve::Linear, float gamma = 1.0f);
+        void autoContrastTo8u(cv::Mat& img, cv::Mat& dst, float lowPct = 1.0f, float highPct = 99.0f, bool useLut = true, float tolerance = 0.0f);
+        void imgToRgb(cv::Mat& img8u, uint8_t* dst, size_t dstStride = 0, int dstChannels = 3);
         ImageStats computeStats(cv::Mat& img);
+        ImageStats computeStats(cv::Mat& img, const cv::Mat& mask);
+        ImageStats computeStats(cv::Mat& img, const cv::Rect& roi, const cv::Mat& mask = cv::Mat());
+        ImageStats computeStatsMultiPass(cv::Mat& img);
 
         cv::Mat generateGaussianKernel(int ksize, float sigma);
         void addKernelToImage(cv::Mat& image, const cv::Mat& kernel, int x, int y);
@@ -63,6 +93,18 @@ namespace CppOpenCVUtil
         std::vector<std::string> getAllExtensions();
         bool checkSupportedExtension(const std::string& ext);
         void renderCollage(const std::vector<cv::Mat>& images, const std::vector<std::string>& captions, const CollageSpec& spec, cv::Mat& dst);
+        void renderCollageBands(const std::vector<cv::Mat>& images, const std::vector<std::string>& captions, const CollageSpec& spec,
+            const CollageBandSink& sink, int tileRowsPerBand = 1);
+        void renderCollage(int imgCount, const CollageImageLoader& loader, const std::vector<std::string>& captions, const CollageSpec& spec,
+            cv::Mat& dst, int maxDecodeThreads = 0);
+        void renderCollage(const std::vector<std::string>& paths, const std::vector<std::string>& captions, const CollageSpec& spec, cv::Mat& dst,
+            int maxDecodeThreads = 0);
+        void renderCollageBands(int imgCount, const CollageImageLoader& loader, const std::vector<std::string>& captions, const CollageSpec& spec,
+            const CollageBandSink& sink, int tileRowsPerBand = 1, int maxDecodeThreads = 0);
+        cv::Mat loadCollageImage(const std::string& path, cv::Size tileSize);
+        CollageImageLoader getCollageFileLoader(const std::vector<std::string>& paths);
+        cv::Size getCollageSize(int imgCount, cv::Size firstImgSize, const CollageSpec& spec);
+        std::string fitTextToWidth(const std::string& text, int maxWidth, int fontFace, double fontScale, int thickness = 1, bool doEllipsis = false, cv::Size* textSize = nullptr);
         void profile(cv::Mat& img, bool doVert, std::vector<float>& profile);
 
         cv::Scalar computeTextColor(cv::Mat& img, cv::Point pixel);
@@ -0,0 +1,66 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#pragma once
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+namespace CppOpenCVUtil
+{
+    namespace ParallelUtil
+    {
+        /**
+         * @brief Choose how many horizontal stripes to split an image into for a row-parallel reduction.
+         * Small images get a single stripe since thread dispatch would cost more than the work.
+         * @param rows Image rows.
+         * @param cols Image cols (times channels, i.e. values per row).
+         * @param minValuesPerStripe Don't split finer than this many values per stripe.
+         * @return Number of stripes, at least 1 (unless rows is 0) and never more than rows.
+         */
+        inline int getStripeCount(int rows, int cols, int minValuesPerStripe = 1 << 16)
+        {
+            if (rows <= 0)
+            {
+                return 0;
+            }
+
+            int64_t total = (int64_t)rows * std::max(cols, 1);
+            int64_t byWork = std::max<int64_t>(1, total / minValuesPerStripe);
+            int byThreads = std::max(1, cv::getNumThreads()) * 4; // a few stripes per thread for load balancing
+
+            return (int)std::min<int64_t>({ byWork, (int64_t)byThreads, (int64_t)rows });
+        }
+
+        /**
+         * @brief Run fn(stripeIndex, rowStart, rowEnd) for each of stripeCount stripes of rows, in parallel.
+         * Each call gets its own stripe index so callers can keep one partial result per stripe and then
+         * merge them in stripe order, which keeps results deterministic regardless of scheduling.
+         * @param rows Total rows to split.
+         * @param stripeCount From getStripeCount().
+         * @param fn Callable (int stripeIndex, int rowStart, int rowEnd), rowEnd exclusive.
+         */
+        template <typename Fn>
+        void parallelForStripes(int rows, int stripeCount, Fn fn)
+        {
+            if (stripeCount <= 0)
+            {
+                return;
+            }
+
+            if (stripeCount == 1)
+            {
+                fn(0, 0, rows);
+                return;
+            }
+
+            cv::parallel_for_(cv::Range(0, stripeCount), [&](const cv::Range& range)
+            {
+                for (int s = range.start; s < range.end; s++)
+                {
+                    int r0 = (int)((int64_t)rows * s / stripeCount);
+                    int r1 = (int)((int64_t)rows * (s + 1) / stripeCount);
+                    fn(s, r0, r1);
+                }
+            });
+        }
+    }
+}
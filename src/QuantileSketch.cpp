@@ -0,0 +1,350 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <numbers>
+
+#include <opencv2/opencv.hpp>
+
+#include "QuantileSketch.h"
+#include "MiscUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+
+namespace CppOpenCVUtil
+{
+    /**
+     * @brief Start of serialized data, "QSK" and a version.
+     */
+    static const uint32_t SketchMagic = 0x014B5351;
+
+    QuantileSketch::QuantileSketch()
+    {
+    }
+
+    QuantileSketch::QuantileSketch(float compression)
+    {
+        CV_Assert(compression >= 10.0f);
+        this->compression = compression;
+    }
+
+    void QuantileSketch::clear()
+    {
+        centroids.clear();
+        buffer.clear();
+        totalWeight = 0.0;
+        minVal = INFINITY;
+        maxVal = -INFINITY;
+    }
+
+    bool QuantileSketch::empty()
+    {
+        return totalWeight <= 0.0;
+    }
+
+    double QuantileSketch::getCount()
+    {
+        return totalWeight;
+    }
+
+    /**
+     * @brief Smallest value added, exact. NAN if empty.
+     */
+    float QuantileSketch::getMin()
+    {
+        return empty() ? NAN : (float)minVal;
+    }
+
+    /**
+     * @brief Largest value added, exact. NAN if empty.
+     */
+    float QuantileSketch::getMax()
+    {
+        return empty() ? NAN : (float)maxVal;
+    }
+
+    int QuantileSketch::getCentroidCount()
+    {
+        flush();
+        return (int)centroids.size();
+    }
+
+    void QuantileSketch::add(float value, double weight)
+    {
+        if (std::isnan(value) || (weight <= 0.0))
+        {
+            return;
+        }
+
+        buffer.push_back({ value, weight });
+        totalWeight += weight;
+        minVal = std::min(minVal, (double)value);
+        maxVal = std::max(maxVal, (double)value);
+
+        // values are buffered and merged in a batch, which is what keeps inserts cheap
+        if (buffer.size() >= (size_t)(compression * 5))
+        {
+            flush();
+        }
+    }
+
+    void QuantileSketch::add(std::span<const float> values)
+    {
+        for (float v : values)
+        {
+            add(v);
+        }
+    }
+
+    /**
+     * @brief Add another sketch's values to this one. The result is about as accurate as a sketch built from all of the values.
+     */
+    void QuantileSketch::merge(const QuantileSketch& other)
+    {
+        buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+        buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+        totalWeight += other.totalWeight;
+        minVal = std::min(minVal, other.minVal);
+        maxVal = std::max(maxVal, other.maxVal);
+        flush();
+    }
+
+    /**
+     * @brief Merge buffered values into the centroids.
+     * Everything is sorted by mean and then neighbors are combined as long as the combined centroid stays within one unit
+     * of the k1 scale function k(q) = compression / (2 pi) * asin(2q - 1). That allows big centroids in the middle and
+     * small ones at the tails, and bounds the count at about compression.
+     */
+    void QuantileSketch::flush()
+    {
+        if (buffer.empty())
+        {
+            return;
+        }
+
+        buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+        std::sort(buffer.begin(), buffer.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+
+        double normalizer = compression / (2.0 * std::numbers::pi);
+        auto kToQ = [&](double k) { return (std::sin(std::min(k / normalizer, std::numbers::pi / 2)) + 1.0) / 2.0; };
+        auto qToK = [&](double q) { return normalizer * std::asin(std::clamp(2.0 * q - 1.0, -1.0, 1.0)); };
+
+        centroids.clear();
+        centroids.push_back(buffer[0]);
+        double weightSoFar = 0.0;
+        double weightLimit = totalWeight * kToQ(qToK(0.0) + 1.0);
+
+        for (size_t i = 1; i < buffer.size(); i++)
+        {
+            Centroid& last = centroids.back();
+            const Centroid& c = buffer[i];
+
+            if (weightSoFar + last.weight + c.weight <= weightLimit)
+            {
+                last.weight += c.weight;
+                last.mean += (c.mean - last.mean) * c.weight / last.weight;
+            }
+            else
+            {
+                weightSoFar += last.weight;
+                weightLimit = totalWeight * kToQ(qToK(weightSoFar / totalWeight) + 1.0);
+                centroids.push_back(c);
+            }
+        }
+
+        buffer.clear();
+    }
+
+    /**
+     * @brief Estimate the value at quantile q (0 to 1) by interpolating between centroid means, with the exact min and max
+     * at the ends.
+     * @param q
+     * @return NAN if empty.
+     */
+    float QuantileSketch::getQuantile(float q)
+    {
+        flush();
+
+        if (centroids.empty())
+        {
+            return NAN;
+        }
+
+        if ((q <= 0.0f) || (centroids.size() == 1 && centroids[0].weight <= 1.0))
+        {
+            return (q >= 1.0f) ? (float)maxVal : (float)minVal;
+        }
+
+        if (q >= 1.0f)
+        {
+            return (float)maxVal;
+        }
+
+        double index = q * totalWeight;
+        const Centroid& first = centroids.front();
+        const Centroid& last = centroids.back();
+
+        // left tail, between min and the middle of the first centroid
+        if (index < first.weight / 2)
+        {
+            return (float)(minVal + (first.mean - minVal) * index / (first.weight / 2));
+        }
+
+        double weightSoFar = first.weight / 2;
+
+        for (size_t i = 0; i + 1 < centroids.size(); i++)
+        {
+            const Centroid& a = centroids[i];
+            const Centroid& b = centroids[i + 1];
+            double dw = (a.weight + b.weight) / 2;
+
+            if (weightSoFar + dw > index)
+            {
+                double t = (index - weightSoFar) / dw;
+                return (float)(a.mean + (b.mean - a.mean) * t);
+            }
+
+            weightSoFar += dw;
+        }
+
+        // right tail, between the middle of the last centroid and max
+        double rightWeight = totalWeight - weightSoFar;
+        double t = (rightWeight > 0) ? (index - weightSoFar) / rightWeight : 1.0;
+        return (float)(last.mean + (maxVal - last.mean) * std::min(1.0, t));
+    }
+
+    float QuantileSketch::getPercentile(float pct)
+    {
+        return getQuantile(pct / 100.0f);
+    }
+
+    void QuantileSketch::getPercentiles(const std::vector<float>& pcts, std::vector<float>& results)
+    {
+        results.resize(pcts.size());
+
+        for (size_t i = 0; i < pcts.size(); i++)
+        {
+            results[i] = getPercentile(pcts[i]);
+        }
+    }
+
+    /**
+     * @brief Compact binary form, in native byte order: magic, compression, count, min, max, then the centroids.
+     * About 16 bytes per centroid, so a few KB at the default compression.
+     */
+    std::vector<uint8_t> QuantileSketch::serialize()
+    {
+        flush();
+
+        uint32_t centroidCount = (uint32_t)centroids.size();
+        std::vector<uint8_t> data(sizeof(uint32_t) * 2 + sizeof(float) + sizeof(double) * 3 + centroidCount * sizeof(Centroid));
+        uint8_t* p = data.data();
+
+        auto put = [&](const void* src, size_t size)
+        {
+            memcpy(p, src, size);
+            p += size;
+        };
+
+        put(&SketchMagic, sizeof(SketchMagic));
+        put(&compression, sizeof(compression));
+        put(&totalWeight, sizeof(totalWeight));
+        put(&minVal, sizeof(minVal));
+        put(&maxVal, sizeof(maxVal));
+        put(&centroidCount, sizeof(centroidCount));
+
+        for (const Centroid& c : centroids)
+        {
+            put(&c.mean, sizeof(c.mean));
+            put(&c.weight, sizeof(c.weight));
+        }
+
+        return data;
+    }
+
+    /**
+     * @brief Replace this sketch with one from serialize().
+     * Bails on truncated or inconsistent data, in which case this sketch is left unchanged.
+     */
+    void QuantileSketch::deserialize(const uint8_t* data, size_t size)
+    {
+        const uint8_t* p = data;
+        const uint8_t* end = data + size;
+
+        auto get = [&](void* dst, size_t n)
+        {
+            if (p + n > end)
+            {
+                bail("QuantileSketch: Serialized data is truncated");
+            }
+
+            memcpy(dst, p, n);
+            p += n;
+        };
+
+        uint32_t magic = 0;
+        get(&magic, sizeof(magic));
+
+        if (magic != SketchMagic)
+        {
+            bail("QuantileSketch: Not serialized sketch data");
+        }
+
+        // parse into locals so a bad payload leaves this sketch unchanged
+        float newCompression = 0.0f;
+        double newTotalWeight = 0.0;
+        double newMinVal = 0.0;
+        double newMaxVal = 0.0;
+        uint32_t centroidCount = 0;
+        get(&newCompression, sizeof(newCompression));
+        get(&newTotalWeight, sizeof(newTotalWeight));
+        get(&newMinVal, sizeof(newMinVal));
+        get(&newMaxVal, sizeof(newMaxVal));
+        get(&centroidCount, sizeof(centroidCount));
+
+        if ((size_t)(end - p) != (size_t)centroidCount * sizeof(double) * 2)
+        {
+            bail("QuantileSketch: Serialized data has the wrong size");
+        }
+
+        if (!std::isfinite(newCompression) || (newCompression <= 0.0f))
+        {
+            bail("QuantileSketch: Serialized data has a bad compression");
+        }
+
+        if (!std::isfinite(newTotalWeight) || (newTotalWeight < 0.0) || ((centroidCount == 0) != (newTotalWeight == 0.0)))
+        {
+            bail("QuantileSketch: Serialized data has a bad total weight");
+        }
+
+        std::vector<Centroid> newCentroids(centroidCount);
+        double weightSum = 0.0;
+
+        for (Centroid& c : newCentroids)
+        {
+            get(&c.mean, sizeof(c.mean));
+            get(&c.weight, sizeof(c.weight));
+
+            if (std::isnan(c.mean) || !std::isfinite(c.weight) || (c.weight <= 0.0))
+            {
+                bail("QuantileSketch: Serialized data has a bad centroid");
+            }
+
+            weightSum += c.weight;
+        }
+
+        if (std::abs(weightSum - newTotalWeight) > newTotalWeight * 1e-6)
+        {
+            bail("QuantileSketch: Serialized centroid weights don't match the total weight");
+        }
+
+        clear();
+        compression = newCompression;
+        totalWeight = newTotalWeight;
+        minVal = newMinVal;
+        maxVal = newMaxVal;
+        centroids = std::move(newCentroids);
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#pragma once
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cmath>
+
+namespace CppOpenCVUtil
+{
+    /**
+     * @brief Bounded-memory streaming quantile estimate (a merging t-digest).
+     * Unlike FloatHist this needs no range up front, and memory stays at a few KB no matter how many values are added,
+     * so it suits long-running tracking of pixel value percentiles. Accuracy is best at the tails (relative to q * (1 - q)),
+     * which is where percentile clipping usually looks. Sketches can be merged (e.g. one per thread or per frame) and
+     * serialized.
+     * NAN is ignored.
+     */
+    struct QuantileSketch
+    {
+        /**
+         * @brief A cluster of nearby values, represented by its mean and how many values it holds.
+         */
+        struct Centroid
+        {
+            double mean = 0.0;
+            double weight = 0.0;
+        };
+
+        /**
+         * @brief Controls the size/accuracy tradeoff, there are at most about this many centroids.
+         * 100 gives rank errors of a fraction of a percent in the middle and much less at the tails.
+         */
+        float compression = 100.0f;
+
+        QuantileSketch();
+        explicit QuantileSketch(float compression);
+
+        void clear();
+        bool empty();
+        double getCount();
+        float getMin();
+        float getMax();
+        int getCentroidCount();
+
+        void add(float value, double weight = 1.0);
+        void add(std::span<const float> values);
+        void merge(const QuantileSketch& other);
+
+        float getQuantile(float q);
+        float getPercentile(float pct);
+        void getPercentiles(const std::vector<float>& pcts, std::vector<float>& results);
+
+        std::vector<uint8_t> serialize();
+        void deserialize(const uint8_t* data, size_t size);
+
+    private:
+        std::vector<Centroid> centroids;
+        std::vector<Centroid> buffer;
+        double totalWeight = 0.0;
+        double minVal = INFINITY;
+        double maxVal = -INFINITY;
+
+        void flush();
+    };
+}
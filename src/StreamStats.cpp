@@ -0,0 +1,248 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+#include "StreamStats.h"
+#include "StripReader.h"
+#include "HistUtil.h"
+#include "MiscUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        StreamStats::StreamStats()
+        {
+        }
+
+        StreamStats::StreamStats(int type)
+        {
+            reset(type);
+        }
+
+        void StreamStats::reset(int type)
+        {
+            if ((type != CV_8U) && (type != CV_16U) && (type != CV_16S) && (type != CV_32S) && (type != CV_32F))
+            {
+                bail("StreamStats: Unsupported image type");
+            }
+
+            this->type = type;
+            width = 0;
+            rowCount = 0;
+            count = 0;
+            nonzeroCount = 0;
+            sum = 0.0;
+            mean = 0.0;
+            m2 = 0.0;
+            minVal = NAN;
+            maxVal = NAN;
+            counts.assign((type == CV_8U) ? 256 : 65536, 0);
+        }
+
+        int StreamStats::getType() const
+        {
+            return type;
+        }
+
+        void StreamStats::add(const cv::Mat& band)
+        {
+            CV_Assert((type >= 0) && (band.type() == type));
+
+            if (band.empty())
+            {
+                return;
+            }
+
+            if (width == 0)
+            {
+                width = band.cols;
+            }
+
+            rowCount += band.rows;
+
+            // stats, merged in the same way as the stripes inside computeStats
+            cv::Mat img = band;
+            ImageStats bandStats = computeStats(img);
+
+            if (bandStats.count > 0)
+            {
+                int64_t n = count + bandStats.count;
+                double delta = bandStats.mean - mean;
+                mean += delta * bandStats.count / n;
+                m2 += bandStats.variance * bandStats.count + delta * delta * ((double)count * bandStats.count / n);
+                minVal = (count == 0) ? bandStats.minVal : std::min(minVal, bandStats.minVal);
+                maxVal = (count == 0) ? bandStats.maxVal : std::max(maxVal, bandStats.maxVal);
+                count = n;
+                nonzeroCount += bandStats.nonzeroCount;
+                sum += bandStats.sum;
+            }
+
+            // hist, int per band then int64 here so the total can pass 2^31
+            static thread_local std::vector<int> bandCounts;
+
+            if ((type == CV_32F) || (type == CV_32S))
+            {
+                histTopKey16(img, bandCounts);
+            }
+            else
+            {
+                histInt(img, 0, bandCounts);
+            }
+
+            for (size_t b = 0; b < counts.size(); b++)
+            {
+                counts[b] += bandCounts[b];
+            }
+        }
+
+        void StreamStats::merge(const StreamStats& other)
+        {
+            CV_Assert(other.type == type);
+
+            if (width == 0)
+            {
+                width = other.width;
+            }
+
+            rowCount += other.rowCount;
+
+            if (other.count > 0)
+            {
+                int64_t n = count + other.count;
+                double delta = other.mean - mean;
+                mean += delta * other.count / n;
+                m2 += other.m2 + delta * delta * ((double)count * other.count / n);
+                minVal = (count == 0) ? other.minVal : std::min(minVal, other.minVal);
+                maxVal = (count == 0) ? other.maxVal : std::max(maxVal, other.maxVal);
+                count = n;
+                nonzeroCount += other.nonzeroCount;
+                sum += other.sum;
+            }
+
+            for (size_t b = 0; b < counts.size(); b++)
+            {
+                counts[b] += other.counts[b];
+            }
+        }
+
+        ImageStats StreamStats::getStats() const
+        {
+            ImageStats stats;
+            stats.type = type;
+            stats.width = width;
+            stats.height = (int)rowCount;
+            stats.channels = 1;
+            stats.count = count;
+            stats.nonzeroCount = nonzeroCount;
+            stats.sum = sum;
+            stats.minVal = minVal;
+            stats.maxVal = maxVal;
+            stats.mean = (count > 0) ? mean : NAN;
+            stats.variance = (count > 0) ? m2 / count : NAN;
+
+            ChannelStats& cs = stats.channelStats[0];
+            cs.count = stats.count;
+            cs.nonzeroCount = stats.nonzeroCount;
+            cs.sum = stats.sum;
+            cs.minVal = stats.minVal;
+            cs.maxVal = stats.maxVal;
+            cs.mean = stats.mean;
+            cs.variance = stats.variance;
+
+            return stats;
+        }
+
+        void StreamStats::getPercentiles(const std::vector<float>& pcts, std::vector<float>& results) const
+        {
+            int pctCount = (int)pcts.size();
+            results.resize(pctCount);
+
+            if (pctCount == 0)
+            {
+                return;
+            }
+
+            // the hist excludes NAN like the stats do, so the stats count is the hist total
+            if (count == 0)
+            {
+                std::fill(results.begin(), results.end(), NAN);
+                return;
+            }
+
+            std::vector<int> binIdxs(pctCount);
+            findPercentilesInHist(counts.data(), (int)counts.size(), count, pcts.data(), pctCount, binIdxs.data());
+
+            for (int i = 0; i < pctCount; i++)
+            {
+                float val;
+
+                if (type == CV_32F)
+                {
+                    val = topKeyBinEdge<float>(binIdxs[i]);
+                }
+                else if (type == CV_32S)
+                {
+                    val = (float)topKeyBinEdge<int32_t>(binIdxs[i]);
+                }
+                else
+                {
+                    val = (float)(binIdxs[i] + ((type == CV_16S) ? Hist16sOffset : 0));
+                }
+
+                // the ends are known exactly, and a coarse bin edge can be outside the actual range
+                if (pcts[i] <= 0.0f)
+                {
+                    results[i] = minVal;
+                }
+                else if (pcts[i] >= 100.0f)
+                {
+                    results[i] = maxVal;
+                }
+                else
+                {
+                    results[i] = std::clamp(val, minVal, maxVal);
+                }
+            }
+        }
+
+        std::vector<float> StreamStats::getPercentiles(const std::vector<float>& pcts) const
+        {
+            std::vector<float> results;
+            getPercentiles(pcts, results);
+            return results;
+        }
+
+        const std::vector<int64_t>& StreamStats::getCounts() const
+        {
+            return counts;
+        }
+
+        /**
+         * @brief Read a whole image with the reader a band at a time and accumulate stats, in memory bounded by the band size.
+         * @param reader Opened reader. Reading starts at its next row.
+         * @param bandRows Rows per band.
+         * @return
+         */
+        StreamStats computeStreamStats(StripReader& reader, int bandRows)
+        {
+            StreamStats stats(reader.getType());
+            cv::Mat band;
+
+            while (reader.readBand(bandRows, band))
+            {
+                stats.add(band);
+            }
+
+            return stats;
+        }
+    }
+}
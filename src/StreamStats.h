@@ -0,0 +1,89 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "ImageStats.h"
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        class StripReader;
+
+        /**
+         * @brief Accumulates stats, a histogram and percentiles over an image fed in row bands or tiles, for images too big
+         * to hold in memory.
+         * Feed any number of bands with add(), from any number of accumulators (e.g. one per thread) combined with merge(),
+         * then read the results. Memory is bounded by the histogram, not the image.
+         * 8U, 16U and 16S keep one exact bin per value so percentiles are exact. 32F and 32S keep a 65536-bin histogram on
+         * the top 16 bits of the value (sign, exponent and 7 mantissa bits for 32F), so 32F percentiles have relative error
+         * at most 1/128 and 32S percentiles are within 65536. Sum, mean and variance are exact to double precision for every
+         * type. Min and max (and so percentiles 0 and 100) are exact for every type except 32S, where like computeStats they
+         * are float and so are rounded to 24 bits for magnitudes above 2^24.
+         * Single channel only. NAN is skipped like computeStats.
+         */
+        class StreamStats
+        {
+        public:
+            StreamStats();
+            explicit StreamStats(int type);
+
+            /**
+             * @brief Clear and set the image type, CV_8U, CV_16U, CV_16S, CV_32S or CV_32F.
+             */
+            void reset(int type);
+
+            int getType() const;
+
+            /**
+             * @brief Accumulate a band (or tile) of the image. The band must have the accumulator's type.
+             * The band is reduced in parallel internally.
+             */
+            void add(const cv::Mat& band);
+
+            /**
+             * @brief Add another accumulator's data to this one. Types must match.
+             * Merging is exact, so accumulating across threads and then merging gives the same result as a single accumulator.
+             */
+            void merge(const StreamStats& other);
+
+            /**
+             * @brief Stats over everything added so far. Width is the width of the first band and height is the total rows,
+             * which is the image size when the bands are full-width strips.
+             */
+            ImageStats getStats() const;
+
+            /**
+             * @brief Nearest-rank percentiles over everything added so far, see histPercentiles.
+             * @param pcts Percentiles to compute, 0 to 100, any order.
+             * @param results Output, one per percentile, NAN if no values have been added.
+             */
+            void getPercentiles(const std::vector<float>& pcts, std::vector<float>& results) const;
+            std::vector<float> getPercentiles(const std::vector<float>& pcts) const;
+
+            /**
+             * @brief The histogram. For 8U/16U one bin per value, for 16S one bin per value starting at Hist16sOffset.
+             * For 32F/32S bin b holds values whose order-preserving key has b as its top 16 bits.
+             */
+            const std::vector<int64_t>& getCounts() const;
+
+        private:
+            int type = -1;
+            int width = 0;
+            int64_t rowCount = 0;
+
+            int64_t count = 0;
+            int64_t nonzeroCount = 0;
+            double sum = 0.0;
+            double mean = 0.0;
+            double m2 = 0.0;
+            float minVal = NAN;
+            float maxVal = NAN;
+
+            std::vector<int64_t> counts;
+        };
+
+        StreamStats computeStreamStats(StripReader& reader, int bandRows = 256);
+    }
+}
@@ -0,0 +1,360 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+#include <opencv2/opencv.hpp>
+
+#include "StripReader.h"
+#include "MiscUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Reverse the bytes of each elemSize-byte value in place.
+         */
+        static void swapBytesInPlace(uint8_t* p, size_t byteCount, size_t elemSize)
+        {
+            for (size_t i = 0; i + elemSize <= byteCount; i += elemSize)
+            {
+                std::reverse(p + i, p + i + elemSize);
+            }
+        }
+
+        /**
+         * @brief Minimal reader for the parts of a classic TIFF header and first IFD that StripReader needs.
+         */
+        struct TiffParser
+        {
+            std::ifstream& file;
+            bool bigEndian = false;
+            int64_t fileSize = 0;
+
+            TiffParser(std::ifstream& file) : file(file)
+            {
+                file.seekg(0, std::ios::end);
+                fileSize = (int64_t)file.tellg();
+            }
+
+            uint64_t readUInt(int64_t offset, int size)
+            {
+                uint8_t buf[8] = {};
+                file.seekg(offset);
+                file.read((char*)buf, size);
+
+                if (!file)
+                {
+                    bail("StripReader: TIFF is truncated");
+                }
+
+                // assemble in the file's byte order, independent of the host
+                uint64_t val = 0;
+
+                for (int i = 0; i < size; i++)
+                {
+                    int shift = bigEndian ? (size - 1 - i) * 8 : i * 8;
+                    val |= (uint64_t)buf[i] << shift;
+                }
+
+                return val;
+            }
+
+            /**
+             * @brief Values of an IFD entry of type BYTE, SHORT or LONG, which are inline if they fit in 4 bytes.
+             * Throws if there are none, or more than the file could hold.
+             */
+            std::vector<int64_t> readEntryValues(int64_t entryOffset)
+            {
+                int fieldType = (int)readUInt(entryOffset + 2, 2);
+                int64_t count = (int64_t)readUInt(entryOffset + 4, 4);
+                int size = (fieldType == 1) ? 1 : (fieldType == 3) ? 2 : (fieldType == 4) ? 4 : 0;
+
+                if (size == 0)
+                {
+                    bail("StripReader: Unexpected TIFF field type");
+                }
+
+                if ((count == 0) || (count * size > fileSize))
+                {
+                    bail("StripReader: Bad TIFF entry count");
+                }
+
+                int64_t valuesOffset = (count * size <= 4) ? entryOffset + 8 : (int64_t)readUInt(entryOffset + 8, 4);
+                std::vector<int64_t> values(count);
+
+                for (int64_t i = 0; i < count; i++)
+                {
+                    values[i] = (int64_t)readUInt(valuesOffset + i * size, size);
+                }
+
+                return values;
+            }
+
+            /**
+             * @brief First value of an IFD entry, for the tags that have a single value.
+             */
+            int64_t readEntryValue(int64_t entryOffset)
+            {
+                return readEntryValues(entryOffset)[0];
+            }
+        };
+
+        void StripReader::openFile(const std::string& path)
+        {
+            close();
+            this->path = path;
+            file.open(path, std::ios::binary);
+
+            if (!file)
+            {
+                bail("StripReader: Could not open " + path);
+            }
+        }
+
+        void StripReader::openTiff(const std::string& path)
+        {
+            openFile(path);
+
+            char order[2] = {};
+            file.read(order, 2);
+
+            bool isLittleEndian = (order[0] == 'I') && (order[1] == 'I');
+            bool isBigEndian = (order[0] == 'M') && (order[1] == 'M');
+
+            if (!isLittleEndian && !isBigEndian)
+            {
+                bail("StripReader: Not a TIFF: " + path);
+            }
+
+            TiffParser parser(file);
+            parser.bigEndian = isBigEndian;
+            swapBytes = isBigEndian != (std::endian::native == std::endian::big);
+
+            int version = (int)parser.readUInt(2, 2);
+
+            if (version == 43)
+            {
+                bail("StripReader: BigTIFF is not supported: " + path);
+            }
+            else if (version != 42)
+            {
+                bail("StripReader: Not a TIFF: " + path);
+            }
+
+            int64_t ifdOffset = (int64_t)parser.readUInt(4, 4);
+            int entryCount = (int)parser.readUInt(ifdOffset, 2);
+
+            int bitsPerSample = 1;
+            int sampleFormat = 1;
+            int compression = 1;
+            int samplesPerPixel = 1;
+            int planarConfig = 1;
+            rowsPerStrip = 0;
+
+            for (int i = 0; i < entryCount; i++)
+            {
+                int64_t entryOffset = ifdOffset + 2 + (int64_t)i * 12;
+                int tag = (int)parser.readUInt(entryOffset, 2);
+
+                switch (tag)
+                {
+                case 256:
+                    width = (int)parser.readEntryValue(entryOffset);
+                    break;
+                case 257:
+                    height = (int)parser.readEntryValue(entryOffset);
+                    break;
+                case 258:
+                    bitsPerSample = (int)parser.readEntryValue(entryOffset);
+                    break;
+                case 259:
+                    compression = (int)parser.readEntryValue(entryOffset);
+                    break;
+                case 273:
+                    stripOffsets = parser.readEntryValues(entryOffset);
+                    break;
+                case 277:
+                    samplesPerPixel = (int)parser.readEntryValue(entryOffset);
+                    break;
+                case 278:
+                    rowsPerStrip = (int)parser.readEntryValue(entryOffset);
+                    break;
+                case 284:
+                    planarConfig = (int)parser.readEntryValue(entryOffset);
+                    break;
+                case 322:
+                    bail("StripReader: Tiled TIFF is not supported: " + path);
+                    break;
+                case 339:
+                    sampleFormat = (int)parser.readEntryValue(entryOffset);
+                    break;
+                }
+            }
+
+            if (compression != 1)
+            {
+                bail("StripReader: Compressed TIFF is not supported: " + path);
+            }
+
+            if ((samplesPerPixel != 1) || (planarConfig != 1))
+            {
+                bail("StripReader: Only single-channel TIFF is supported: " + path);
+            }
+
+            if ((width <= 0) || (height <= 0) || stripOffsets.empty())
+            {
+                bail("StripReader: TIFF is missing size or strips: " + path);
+            }
+
+            // missing rows per strip means one strip
+            if ((rowsPerStrip <= 0) || (rowsPerStrip > height))
+            {
+                rowsPerStrip = height;
+            }
+
+            if ((int64_t)stripOffsets.size() < ((int64_t)height + rowsPerStrip - 1) / rowsPerStrip)
+            {
+                bail("StripReader: TIFF has too few strips: " + path);
+            }
+
+            if ((bitsPerSample == 8) && (sampleFormat == 1))
+            {
+                type = CV_8U;
+            }
+            else if ((bitsPerSample == 16) && (sampleFormat == 1))
+            {
+                type = CV_16U;
+            }
+            else if ((bitsPerSample == 16) && (sampleFormat == 2))
+            {
+                type = CV_16S;
+            }
+            else if ((bitsPerSample == 32) && (sampleFormat == 2))
+            {
+                type = CV_32S;
+            }
+            else if ((bitsPerSample == 32) && (sampleFormat == 3))
+            {
+                type = CV_32F;
+            }
+            else
+            {
+                bail("StripReader: Unsupported TIFF sample type: " + path);
+            }
+        }
+
+        void StripReader::openRaw(const std::string& path, int width, int height, int type, int64_t headerBytes, bool bigEndian)
+        {
+            CV_Assert((width > 0) && (height > 0));
+            CV_Assert((type == CV_8U) || (type == CV_16U) || (type == CV_16S) || (type == CV_32S) || (type == CV_32F));
+            openFile(path);
+
+            this->width = width;
+            this->height = height;
+            this->type = type;
+            swapBytes = bigEndian != (std::endian::native == std::endian::big);
+            stripOffsets = { headerBytes };
+            rowsPerStrip = height;
+        }
+
+        void StripReader::close()
+        {
+            if (file.is_open())
+            {
+                file.close();
+            }
+
+            file.clear();
+            width = 0;
+            height = 0;
+            type = -1;
+            nextRow = 0;
+            stripOffsets.clear();
+            rowsPerStrip = 0;
+        }
+
+        int StripReader::getWidth() const
+        {
+            return width;
+        }
+
+        int StripReader::getHeight() const
+        {
+            return height;
+        }
+
+        int StripReader::getType() const
+        {
+            return type;
+        }
+
+        int StripReader::getNextRow() const
+        {
+            return nextRow;
+        }
+
+        bool StripReader::readBand(int maxRows, cv::Mat& band)
+        {
+            CV_Assert(maxRows > 0);
+
+            if (!file.is_open() || (nextRow >= height))
+            {
+                return false;
+            }
+
+            int rowCount = std::min(maxRows, height - nextRow);
+            band.create(rowCount, width, type);
+
+            size_t elemSize = band.elemSize();
+            size_t rowBytes = (size_t)width * elemSize;
+            int r = 0;
+
+            // read runs of rows that are contiguous in the file, at most to the end of the current strip
+            while (r < rowCount)
+            {
+                int row = nextRow + r;
+                int strip = row / rowsPerStrip;
+                int runRows = std::min(rowCount - r, (strip + 1) * rowsPerStrip - row);
+                int64_t offset = stripOffsets[strip] + (int64_t)(row - strip * rowsPerStrip) * (int64_t)rowBytes;
+
+                file.seekg(offset);
+
+                if (band.isContinuous())
+                {
+                    file.read((char*)band.ptr(r), (std::streamsize)(rowBytes * runRows));
+                }
+                else
+                {
+                    for (int i = 0; i < runRows; i++)
+                    {
+                        file.read((char*)band.ptr(r + i), (std::streamsize)rowBytes);
+                    }
+                }
+
+                if (!file)
+                {
+                    bail("StripReader: File is truncated: " + path);
+                }
+
+                if (swapBytes && (elemSize > 1))
+                {
+                    for (int i = 0; i < runRows; i++)
+                    {
+                        swapBytesInPlace(band.ptr(r + i), rowBytes, elemSize);
+                    }
+                }
+
+                r += runRows;
+            }
+
+            nextRow += rowCount;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Reads an image from a file a band of rows at a time, so images bigger than memory can be processed in pieces
+         * (see StreamStats).
+         * Handles headerless raw files, and single-channel uncompressed striped TIFF (classic TIFF, either byte order), which
+         * is what most large mosaic and slide exporters can write. Sample types are those StreamStats accepts, 8U, 16U, 16S,
+         * 32S and 32F. Compressed, tiled, multi-channel and BigTIFF files, and other sample types, are rejected with an
+         * exception.
+         */
+        class StripReader
+        {
+        public:
+            /**
+             * @brief Open a TIFF.
+             */
+            void openTiff(const std::string& path);
+
+            /**
+             * @brief Open a headerless raw file of single-channel rows with no padding.
+             * @param path
+             * @param width
+             * @param height
+             * @param type CV_8U, CV_16U, CV_16S, CV_32S or CV_32F, the types StreamStats accepts.
+             * @param headerBytes Bytes to skip at the start of the file.
+             * @param bigEndian Whether multi-byte values are big-endian.
+             */
+            void openRaw(const std::string& path, int width, int height, int type, int64_t headerBytes = 0, bool bigEndian = false);
+
+            void close();
+
+            int getWidth() const;
+            int getHeight() const;
+            int getType() const;
+
+            /**
+             * @brief Next row to be read by readBand.
+             */
+            int getNextRow() const;
+
+            /**
+             * @brief Read the next band of rows.
+             * @param maxRows Read at most this many rows, fewer at the end of the image.
+             * @param band Output, reallocated only if the size changes, so the same Mat can be reused for every band.
+             * @return false if there were no more rows.
+             */
+            bool readBand(int maxRows, cv::Mat& band);
+
+        private:
+            std::ifstream file;
+            std::string path;
+            int width = 0;
+            int height = 0;
+            int type = -1;
+            bool swapBytes = false;
+            int nextRow = 0;
+
+            /**
+             * @brief File offset of each strip, a raw file is a single strip.
+             */
+            std::vector<int64_t> stripOffsets;
+            int rowsPerStrip = 0;
+
+            void openFile(const std::string& path);
+        };
+    }
+}
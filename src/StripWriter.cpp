@@ -0,0 +1,210 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+#include <opencv2/opencv.hpp>
+
+#include "StripWriter.h"
+#include "MiscUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Aim for strips of about this many bytes, a common size that readers handle well.
+         */
+        static const int TiffStripBytes = 256 * 1024;
+
+        StripWriter::~StripWriter()
+        {
+            if (file.is_open())
+            {
+                file.close();
+            }
+        }
+
+        void StripWriter::openTiff(const std::string& path, int width, int height, int type)
+        {
+            CV_Assert((width > 0) && (height > 0));
+            CV_Assert((type == CV_8UC1) || (type == CV_8UC3) || (type == CV_16UC1) || (type == CV_16UC3));
+
+            if (file.is_open())
+            {
+                file.close();
+            }
+
+            int channels = CV_MAT_CN(type);
+            int bitsPerSample = (CV_MAT_DEPTH(type) == CV_8U) ? 8 : 16;
+            int64_t rowBytes = (int64_t)width * channels * bitsPerSample / 8;
+            int rowsPerStrip = (int)std::clamp<int64_t>(TiffStripBytes / rowBytes, 1, height);
+            int stripCount = (height + rowsPerStrip - 1) / rowsPerStrip;
+
+            // header, IFD, then the arrays that don't fit in IFD entries, then the image data
+            const int entryCount = 10;
+            uint32_t ifdOffset = 8;
+            uint32_t bitsOffset = ifdOffset + 2 + entryCount * 12 + 4;
+            uint32_t offsetsOffset = bitsOffset + 8;
+            uint32_t countsOffset = offsetsOffset + stripCount * 4;
+            uint32_t dataOffset = countsOffset + stripCount * 4;
+
+            if (dataOffset + rowBytes * height > (int64_t)UINT32_MAX)
+            {
+                bail("StripWriter: Image is too big for a classic TIFF: " + path);
+            }
+
+            file.open(path, std::ios::binary | std::ios::trunc);
+
+            if (!file)
+            {
+                bail("StripWriter: Could not create " + path);
+            }
+
+            this->path = path;
+            this->width = width;
+            this->height = height;
+            this->type = type;
+            nextRow = 0;
+
+            // everything in native byte order, which the byte order mark says
+            auto put = [&](uint32_t val, int size)
+            {
+                uint16_t v16 = (uint16_t)val;
+                file.write(size == 2 ? (const char*)&v16 : (const char*)&val, size);
+            };
+
+            auto entry = [&](int tag, int fieldType, uint32_t count, uint32_t val)
+            {
+                put(tag, 2);
+                put(fieldType, 2);
+                put(count, 4);
+
+                // a single SHORT is left-justified in the value field
+                if ((fieldType == 3) && (count == 1))
+                {
+                    put(val, 2);
+                    put(0, 2);
+                }
+                else
+                {
+                    put(val, 4);
+                }
+            };
+
+            file.write((std::endian::native == std::endian::little) ? "II" : "MM", 2);
+            put(42, 2);
+            put(ifdOffset, 4);
+
+            put(entryCount, 2);
+            entry(256, 4, 1, width);
+            entry(257, 4, 1, height);
+
+            if (channels == 1)
+            {
+                entry(258, 3, 1, bitsPerSample);
+            }
+            else
+            {
+                entry(258, 3, channels, bitsOffset);
+            }
+
+            entry(259, 3, 1, 1);
+            entry(262, 3, 1, (channels == 1) ? 1 : 2);
+            entry(273, 4, stripCount, (stripCount == 1) ? dataOffset : offsetsOffset); // a single value is inline
+            entry(277, 3, 1, channels);
+            entry(278, 4, 1, rowsPerStrip);
+            entry(279, 4, stripCount, (stripCount == 1) ? (uint32_t)(rowBytes * height) : countsOffset);
+            entry(284, 3, 1, 1);
+            put(0, 4);
+
+            for (int i = 0; i < 4; i++)
+            {
+                put((i < channels) ? bitsPerSample : 0, 2);
+            }
+
+            for (int s = 0; s < stripCount; s++)
+            {
+                put((uint32_t)(dataOffset + (int64_t)s * rowsPerStrip * rowBytes), 4);
+            }
+
+            for (int s = 0; s < stripCount; s++)
+            {
+                put((uint32_t)(std::min(rowsPerStrip, height - s * rowsPerStrip) * rowBytes), 4);
+            }
+
+            rowBuf.resize(rowBytes);
+        }
+
+        void StripWriter::writeBand(const cv::Mat& band)
+        {
+            if (!file.is_open())
+            {
+                bail("StripWriter: Not open");
+            }
+
+            CV_Assert((band.type() == type) && (band.cols == width));
+
+            if (nextRow + band.rows > height)
+            {
+                bail("StripWriter: More rows than the image height: " + path);
+            }
+
+            size_t rowBytes = rowBuf.size();
+
+            for (int y = 0; y < band.rows; y++)
+            {
+                if (band.channels() == 3)
+                {
+                    // BGR to RGB into the row buffer
+                    cv::Mat rgb(1, width, type, rowBuf.data());
+                    cv::cvtColor(band.row(y), rgb, cv::COLOR_BGR2RGB);
+                    file.write((const char*)rowBuf.data(), rowBytes);
+                }
+                else
+                {
+                    file.write((const char*)band.ptr(y), rowBytes);
+                }
+            }
+
+            if (!file)
+            {
+                bail("StripWriter: Write failed: " + path);
+            }
+
+            nextRow += band.rows;
+        }
+
+        void StripWriter::close()
+        {
+            if (!file.is_open())
+            {
+                return;
+            }
+
+            file.close();
+
+            if (nextRow < height)
+            {
+                bail("StripWriter: Closed before all rows were written: " + path);
+            }
+        }
+
+        int StripWriter::getNextRow() const
+        {
+            return nextRow;
+        }
+
+        CollageBandSink StripWriter::getCollageSink()
+        {
+            return [this](const cv::Mat& band, int)
+            {
+                writeBand(band);
+            };
+        }
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright(c) 2023 Ryan Seghers
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include "CollageSpec.h"
+
+namespace CppOpenCVUtil
+{
+    namespace ImageUtil
+    {
+        /**
+         * @brief Writes an uncompressed striped TIFF a band of rows at a time, so images bigger than memory can be written in
+         * pieces (e.g. from renderCollageBands). Single-channel files can be read back a band at a time with StripReader,
+         * 3-channel ones (like collages) with imread.
+         * The size is given up front, and since the data is uncompressed the whole header is written when the file is opened.
+         * Bands can be any height. Classic TIFF in native byte order, so the file must be under 4 GB.
+         */
+        class StripWriter
+        {
+        public:
+            ~StripWriter();
+
+            /**
+             * @brief Create a TIFF and write its header.
+             * @param path
+             * @param width
+             * @param height
+             * @param type CV_8UC1, CV_8UC3, CV_16UC1 or CV_16UC3. 3-channel bands are BGR like the rest of OpenCV, and are
+             *     stored as RGB.
+             */
+            void openTiff(const std::string& path, int width, int height, int type);
+
+            /**
+             * @brief Write the next band of rows, of the type and width given to openTiff.
+             */
+            void writeBand(const cv::Mat& band);
+
+            /**
+             * @brief Finish the file. Throws if fewer rows than the height were written.
+             */
+            void close();
+
+            /**
+             * @brief Next row to be written by writeBand.
+             */
+            int getNextRow() const;
+
+            /**
+             * @brief A sink for renderCollageBands that writes each band to this writer.
+             */
+            CollageBandSink getCollageSink();
+
+        private:
+            std::ofstream file;
+            std::string path;
+            int width = 0;
+            int height = 0;
+            int type = -1;
+            int nextRow = 0;
+            std::vector<uint8_t> rowBuf;
+        };
+    }
+}
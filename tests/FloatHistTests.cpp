@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#include "FloatHist.h"
+#include "VectorUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+using namespace CppOpenCVUtil;
+
+namespace CppOpenCVUtilTests
+{
+    static int64_t histTotal(const FloatHist& hist)
+    {
+        return std::accumulate(hist.counts.begin(), hist.counts.end(), (int64_t)0);
+    }
+
+    TEST(FloatHistTests, testAddMatchesCompute)
+    {
+        std::vector<float> values = vectorRandomFloat(1, 1000, -5.0f, 20.0f);
+        values.push_back(NAN);
+        values.push_back(100.0f); // out of range, dropped
+
+        FloatHist expected;
+        expected.compute(values, 25, -5.0f, 20.0f);
+
+        // one at a time and in pieces
+        FloatHist single, pieces;
+        single.init(25, -5.0f, 20.0f);
+        pieces.init(25, -5.0f, 20.0f);
+
+        for (float v : values)
+        {
+            single.add(v);
+        }
+
+        pieces.add(std::span<const float>(values).first(300));
+        pieces.add(std::span<const float>(values).subspan(300));
+
+        EXPECT_EQ(expected.counts, single.counts);
+        EXPECT_EQ(expected.counts, pieces.counts);
+        EXPECT_EQ(expected.bins, pieces.bins);
+        EXPECT_EQ(1001, histTotal(pieces));
+    }
+
+    TEST(FloatHistTests, testMerge)
+    {
+        std::vector<float> values = vectorRandomFloat(2, 2000, 0.0f, 10.0f);
+        std::span<const float> all(values);
+
+        FloatHist whole, a, b;
+        whole.compute(values, 20, 0.0f, 10.0f);
+        a.compute(std::vector<float>(all.begin(), all.begin() + 700), 20, 0.0f, 10.0f);
+        b.compute(std::vector<float>(all.begin() + 700, all.end()), 20, 0.0f, 10.0f);
+
+        // same bins, exact
+        ASSERT_TRUE(a.isSameBinning(b));
+        a.merge(b);
+        EXPECT_EQ(whole.counts, a.counts);
+
+        // merge into empty is a copy
+        FloatHist empty;
+        empty.merge(whole);
+        EXPECT_EQ(whole.counts, empty.counts);
+
+        // rebin 20 bins into 10 over the same range, pairs of bins add up exactly
+        FloatHist coarse;
+        coarse.init(10, 0.0f, 10.0f);
+        coarse.merge(whole);
+
+        for (int i = 0; i < 10; i++)
+        {
+            EXPECT_EQ(whole.counts[2 * i] + whole.counts[2 * i + 1], coarse.counts[i]);
+        }
+
+        // rebin into offset bins, total kept and each bin close to a direct compute
+        FloatHist shifted, direct;
+        shifted.init(8, 0.0f, 10.0f);
+        shifted.merge(whole);
+        direct.compute(values, 8, 0.0f, 10.0f);
+        EXPECT_EQ(histTotal(whole), histTotal(shifted));
+
+        for (int i = 0; i < 8; i++)
+        {
+            EXPECT_NEAR(direct.counts[i], shifted.counts[i], 0.1 * direct.counts[i]);
+        }
+    }
+
+    TEST(FloatHistTests, testComputeStridedAndMat)
+    {
+        cv::Mat mat(40, 30, CV_32F);
+        cv::randu(mat, -3.0, 7.0);
+        mat.at<float>(4, 4) = NAN;
+
+        std::vector<float> values;
+
+        for (int y = 0; y < mat.rows; y++)
+        {
+            for (int x = 0; x < mat.cols; x++)
+            {
+                values.push_back(mat.at<float>(y, x));
+            }
+        }
+
+        FloatHist expected;
+        expected.compute(values, 16);
+
+        // whole mat and a non-continuous roi of it
+        FloatHist fromMat;
+        fromMat.compute(mat, 16);
+        EXPECT_EQ(expected.minVal, fromMat.minVal);
+        EXPECT_EQ(expected.maxVal, fromMat.maxVal);
+        EXPECT_EQ(expected.counts, fromMat.counts);
+
+        FloatHist fromRoi, fromCopy;
+        fromRoi.compute(mat(cv::Rect(2, 3, 20, 30)), 16, -3.0f, 7.0f);
+        fromCopy.compute(mat(cv::Rect(2, 3, 20, 30)).clone(), 16, -3.0f, 7.0f);
+        EXPECT_EQ(fromCopy.counts, fromRoi.counts);
+
+        // one column by stride
+        FloatHist fromColumn;
+        fromColumn.compute(mat.ptr<float>(0) + 5, mat.rows, mat.cols, 16, -3.0f, 7.0f);
+        EXPECT_EQ(mat.rows, histTotal(fromColumn));
+
+        // same bin count keeps the storage
+        const int* countsData = fromColumn.counts.data();
+        fromColumn.compute(mat.ptr<float>(0) + 6, mat.rows, mat.cols, 16, -1.0f, 1.0f);
+        EXPECT_EQ(countsData, fromColumn.counts.data());
+    }
+
+    TEST(FloatHistTests, testLogAndEdgeBins)
+    {
+        // one bin per decade
+        FloatHist logHist;
+        logHist.initLog(5, 1.0f, 100000.0f);
+        std::vector<float> values = { 0.5f, 1.0f, 5.0f, 50.0f, 99.0f, 101.0f, 5000.0f, 99999.0f, 200000.0f, NAN };
+        logHist.add(values);
+        EXPECT_EQ(FloatHistBinMode::Log, logHist.binMode);
+        EXPECT_NEAR(1000.0f, logHist.bins[3], 0.01f);
+        EXPECT_EQ(std::vector<int>({ 2, 2, 1, 1, 2 }), logHist.counts);
+        EXPECT_TRUE(std::isnan(logHist.getBinSize()));
+
+        // arbitrary edges, checked against a linear scan
+        std::vector<float> edges = { -10.0f, -1.0f, 0.0f, 0.5f, 2.0f, 3.0f, 30.0f, 31.0f };
+        FloatHist edgeHist;
+        edgeHist.initEdges(edges);
+        std::vector<float> randomValues = vectorRandomFloat(3, 5000, -20.0f, 40.0f);
+        edgeHist.add(randomValues);
+
+        std::vector<int> expected(edges.size() - 1);
+
+        for (float v : randomValues)
+        {
+            for (size_t i = 0; i + 1 < edges.size(); i++)
+            {
+                if ((v >= edges[i]) && ((v < edges[i + 1]) || ((i + 2 == edges.size()) && (v == edges[i + 1]))))
+                {
+                    expected[i]++;
+                }
+            }
+        }
+
+        EXPECT_EQ(expected, edgeHist.counts);
+
+        // merge uniform into edges by rebinning, total in range kept
+        FloatHist uniform;
+        uniform.compute(randomValues, 62, -10.0f, 31.0f);
+        FloatHist merged;
+        merged.initEdges(edges);
+        merged.merge(uniform);
+        EXPECT_EQ(histTotal(uniform), histTotal(merged));
+    }
+
+    TEST(FloatHistTests, testSummaryStats)
+    {
+        std::vector<float> values = vectorRandomFloat(7, 20000, 10.0f, 20.0f);
+
+        for (int i = 0; i < 2000; i++)
+        {
+            values.push_back(12.3f);
+        }
+
+        FloatHist hist;
+        hist.compute(values, 100, 10.0f, 20.0f);
+        EXPECT_EQ((int64_t)values.size(), hist.getTotalCount());
+        EXPECT_EQ(hist.getTotalCount(), hist.getCumulativeCounts().back());
+
+        std::vector<float> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+
+        for (float pct : { 1.0f, 25.0f, 50.0f, 99.0f })
+        {
+            size_t idx = (size_t)std::ceil(pct / 100.0 * sorted.size()) - 1;
+            EXPECT_NEAR(sorted[idx], hist.getPercentile(pct), hist.getBinSize()) << "pct " << pct;
+        }
+
+        double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+        double m2 = 0.0;
+
+        for (float v : values)
+        {
+            m2 += (v - mean) * (v - mean);
+        }
+
+        EXPECT_NEAR(mean, hist.getMean(), 0.01);
+        EXPECT_NEAR(m2 / values.size(), hist.getVariance(), 0.05);
+        EXPECT_NEAR(12.3f, hist.getMode(), hist.getBinSize());
+
+        // cache is invalidated by adds
+        hist.add(19.5f);
+        EXPECT_EQ((int64_t)values.size() + 1, hist.getTotalCount());
+
+        // and a direct edit of counts that changes the total is caught without invalidateCumulative
+        hist.counts[0] += 1000;
+        EXPECT_EQ((int64_t)values.size() + 1001, hist.getTotalCount());
+        EXPECT_NEAR(10.0f, hist.getPercentile(1.0f), hist.getBinSize());
+
+        FloatHist empty;
+        EXPECT_TRUE(std::isnan(empty.getPercentile(50)));
+        EXPECT_TRUE(std::isnan(empty.getMean()));
+    }
+}
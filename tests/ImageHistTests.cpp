@@ -0,0 +1,501 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <climits>
+#include <fmt/core.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+
+using namespace std;
+using namespace CppOpenCVUtil;
+
+namespace CppOpenCVUtilTests
+{
+    template <typename T>
+    static std::vector<int> histIntNaive(cv::Mat& img, int binShift)
+    {
+        std::vector<int> counts((sizeof(T) == 1 ? 256 : 65536) >> binShift);
+
+        for (int y = 0; y < img.rows; y++)
+        {
+            for (int x = 0; x < img.cols; x++)
+            {
+                counts[img.at<T>(y, x) >> binShift]++;
+            }
+        }
+
+        return counts;
+    }
+
+    TEST(ImageHistTests, testHistIntMatchesNaive)
+    {
+        cv::Mat img8(123, 301, CV_8U);
+        cv::randu(img8, 0, 256);
+        img8(cv::Rect(0, 0, 50, 50)).setTo(cv::Scalar(7)); // a run of equal values
+
+        cv::Mat img16(123, 301, CV_16U);
+        cv::randu(img16, 0, 65536);
+
+        for (int binShift : { 0, 3 })
+        {
+            EXPECT_EQ(histIntNaive<uint8_t>(img8, binShift), ImageUtil::histInt(img8, binShift));
+            EXPECT_EQ(histIntNaive<uint16_t>(img16, binShift), ImageUtil::histInt(img16, binShift));
+        }
+
+        // non-continuous, odd width
+        cv::Mat roi = img16(cv::Rect(1, 2, 33, 100));
+        EXPECT_EQ(histIntNaive<uint16_t>(roi, 0), ImageUtil::histInt(roi));
+    }
+
+    TEST(ImageHistTests, testHistIntReusesBuffer)
+    {
+        cv::Mat img(64, 64, CV_16U);
+        cv::randu(img, 0, 65536);
+
+        std::vector<int> counts;
+        ImageUtil::histInt(img, counts);
+        const int* data = counts.data();
+        EXPECT_EQ(histIntNaive<uint16_t>(img, 0), counts);
+
+        // second call into same buffer should not reallocate, and should not accumulate
+        ImageUtil::histInt(img, counts);
+        EXPECT_EQ(data, counts.data());
+        EXPECT_EQ(histIntNaive<uint16_t>(img, 0), counts);
+    }
+
+    static float percentileBySort(cv::Mat& img, float pct)
+    {
+        std::vector<float> values;
+
+        for (int y = 0; y < img.rows; y++)
+        {
+            for (int x = 0; x < img.cols; x++)
+            {
+                float v = img.at<float>(y, x);
+
+                if (!std::isnan(v))
+                {
+                    values.push_back(v);
+                }
+            }
+        }
+
+        std::sort(values.begin(), values.end());
+        int64_t k = (int64_t)std::ceil(pct / 100.0 * values.size()) - 1;
+        return values[std::clamp<int64_t>(k, 0, values.size() - 1)];
+    }
+
+    TEST(ImageHistTests, testHistPercentiles32fExact)
+    {
+        cv::Mat img(200, 150, CV_32F);
+        cv::randu(img, -1000.0, 5000.0);
+        img.at<float>(3, 3) = NAN;
+        img.at<float>(4, 4) = NAN;
+        img.at<float>(5, 5) = INFINITY;
+        img.at<float>(6, 6) = -INFINITY;
+
+        for (std::pair<float, float> pcts : { std::pair<float, float>(1.0f, 99.0f), { 0.0f, 100.0f }, { 37.5f, 50.0f } })
+        {
+            std::pair<float, float> actual = ImageUtil::histPercentiles32f(img, pcts.first, pcts.second);
+            EXPECT_EQ(percentileBySort(img, pcts.first), actual.first);
+            EXPECT_EQ(percentileBySort(img, pcts.second), actual.second);
+        }
+
+        // coarse is within tolerance
+        std::pair<float, float> coarse = ImageUtil::histPercentiles32f(img, 5.0f, 95.0f, 0.01f);
+        float expectedLow = percentileBySort(img, 5.0f);
+        float expectedHigh = percentileBySort(img, 95.0f);
+        EXPECT_NEAR(expectedLow, coarse.first, std::abs(expectedLow) / 128.0f);
+        EXPECT_NEAR(expectedHigh, coarse.second, std::abs(expectedHigh) / 128.0f);
+
+        // all nan
+        img = NAN;
+        EXPECT_TRUE(std::isnan(ImageUtil::histPercentiles32f(img, 1.0f, 99.0f).first));
+    }
+
+    TEST(ImageHistTests, testHistPercentilesMulti)
+    {
+        std::vector<float> pcts = { 50.0f, 1.0f, 99.0f, 5.0f, 95.0f };
+
+        // 16U against sorted values
+        cv::Mat img16(100, 90, CV_16U);
+        cv::randu(img16, 0, 4000);
+        cv::Mat img32f;
+        img16.convertTo(img32f, CV_32F);
+        std::vector<float> results = ImageUtil::histPercentiles(img16, pcts);
+        ASSERT_EQ(pcts.size(), results.size());
+
+        for (size_t i = 0; i < pcts.size(); i++)
+        {
+            EXPECT_EQ(percentileBySort(img32f, pcts[i]), results[i]);
+        }
+
+        // 32F and 32S give same exact values
+        cv::Mat img32s;
+        img16.convertTo(img32s, CV_32S, 1.0, -2000.0);
+        img32s.convertTo(img32f, CV_32F);
+        std::vector<float> results32s = ImageUtil::histPercentiles(img32s, pcts);
+        std::vector<float> results32f = ImageUtil::histPercentiles(img32f, pcts);
+
+        for (size_t i = 0; i < pcts.size(); i++)
+        {
+            EXPECT_EQ(percentileBySort(img32f, pcts[i]), results32s[i]);
+            EXPECT_EQ(percentileBySort(img32f, pcts[i]), results32f[i]);
+        }
+
+        // pair api agrees
+        std::pair<float, float> lowHigh = ImageUtil::histPercentiles(img16, 1.0f, 99.0f);
+        EXPECT_EQ(results[1], lowHigh.first);
+        EXPECT_EQ(results[2], lowHigh.second);
+
+        // every percentile of a wide range, each in its own top bin, more than one second level pass holds
+        cv::Mat wide(150, 140, CV_32F);
+        cv::randu(wide, -1e6, 1e6);
+        std::vector<float> allPcts;
+
+        for (int i = 0; i <= 200; i++)
+        {
+            allPcts.push_back(i * 0.5f);
+        }
+
+        std::vector<float> allResults = ImageUtil::histPercentiles(wide, allPcts);
+
+        for (size_t i = 0; i < allPcts.size(); i++)
+        {
+            EXPECT_EQ(percentileBySort(wide, allPcts[i]), allResults[i]);
+        }
+    }
+
+    TEST(ImageHistTests, testHist16sAnd32s)
+    {
+        cv::Mat img32s(80, 70, CV_32S);
+        cv::randu(img32s, -30000, 30000);
+        cv::Mat img16s;
+        img32s.convertTo(img16s, CV_16S);
+        cv::Mat img32f;
+        img32s.convertTo(img32f, CV_32F);
+
+        // 16S is offset-binned
+        std::vector<int> counts = ImageUtil::histInt(img16s);
+        ASSERT_EQ(65536, counts.size());
+        EXPECT_GT(counts[img16s.at<int16_t>(0, 0) - ImageUtil::Hist16sOffset], 0);
+
+        // adaptive 32S, narrow range is exact
+        int offset, binShift;
+        ImageUtil::histIntAdaptive(img32s, 65536, counts, offset, binShift);
+        EXPECT_EQ(0, binShift);
+        std::vector<int> counts16s = ImageUtil::histInt(img16s);
+
+        for (int i = 0; i < (int)counts.size(); i++)
+        {
+            EXPECT_EQ(counts16s[offset + i - ImageUtil::Hist16sOffset], counts[i]);
+        }
+
+        // adaptive 32S, wide range
+        img32s.at<int>(0, 0) = INT_MIN;
+        img32s.at<int>(0, 1) = INT_MAX;
+        ImageUtil::histIntAdaptive(img32s, 1024, counts, offset, binShift);
+        EXPECT_EQ(INT_MIN, offset);
+        EXPECT_EQ(22, binShift);
+        EXPECT_EQ(1024, counts.size());
+        EXPECT_EQ(1, counts[0]);
+        EXPECT_EQ(1, counts[1023]);
+
+        // a single bin holds the whole range, and no bins is an error
+        ImageUtil::histIntAdaptive(img32s, 1, counts, offset, binShift);
+        EXPECT_EQ(32, binShift);
+        EXPECT_EQ(std::vector<int>(1, (int)img32s.total()), counts);
+        EXPECT_ANY_THROW(ImageUtil::histIntAdaptive(img32s, 0, counts, offset, binShift));
+
+        // percentiles
+        img32s.convertTo(img32f, CV_32F);
+        std::pair<float, float> lowHigh = ImageUtil::histPercentiles(img32s, 1.0f, 99.0f);
+        EXPECT_EQ(percentileBySort(img32f, 1.0f), lowHigh.first);
+        EXPECT_EQ(percentileBySort(img32f, 99.0f), lowHigh.second);
+
+        img16s.convertTo(img32f, CV_32F);
+        lowHigh = ImageUtil::histPercentiles(img16s, 1.0f, 99.0f);
+        EXPECT_EQ(percentileBySort(img32f, 1.0f), lowHigh.first);
+        EXPECT_EQ(percentileBySort(img32f, 99.0f), lowHigh.second);
+    }
+
+    TEST(ImageHistTests, testHistCumulativeAndMoments)
+    {
+        cv::Mat img(150, 170, CV_16S);
+        cv::randu(img, -3000, 3000);
+        img(cv::Rect(0, 0, 40, 40)).setTo(cv::Scalar(-1234));
+
+        std::vector<int> counts;
+        ImageUtil::histInt(img, 0, counts);
+        std::vector<int64_t> cumCounts;
+        ImageUtil::histCumulative(counts, cumCounts);
+
+        std::vector<float> pcts = { 0, 1, 37, 50, 99, 100 };
+        std::vector<float> expected = ImageUtil::histPercentiles(img, pcts);
+
+        for (size_t i = 0; i < pcts.size(); i++)
+        {
+            EXPECT_EQ(expected[i], ImageUtil::histPercentileFromCumulative(cumCounts, pcts[i], ImageUtil::Hist16sOffset));
+        }
+
+        // exact with no bin shift
+        ImageUtil::HistMoments moments = ImageUtil::histMoments(counts, ImageUtil::Hist16sOffset);
+        ImageUtil::ImageStats stats = ImageUtil::computeStats(img);
+        EXPECT_EQ(stats.count, moments.count);
+        EXPECT_NEAR(stats.mean, moments.mean, 1e-9 * std::abs(stats.mean) + 1e-9);
+        EXPECT_NEAR(stats.variance, moments.variance, 1e-9 * stats.variance);
+        EXPECT_EQ(-1234.0f, moments.mode);
+
+        // bins 2^31 and 2^32 wide, from the full 32S range
+        cv::Mat img32s(10, 10, CV_32S, cv::Scalar(0));
+        img32s.at<int>(0, 0) = INT_MIN;
+        img32s.at<int>(0, 1) = INT_MAX;
+        int offset, binShift;
+
+        for (int maxBinCount : { 2, 1 })
+        {
+            ImageUtil::histIntAdaptive(img32s, maxBinCount, counts, offset, binShift);
+            moments = ImageUtil::histMoments(counts, offset, binShift);
+            EXPECT_EQ(33 - maxBinCount, binShift);
+            EXPECT_NEAR(0.0, moments.mean, 1.0 + std::ldexp(1.0, binShift) / 2.0);
+            EXPECT_GE(moments.variance, 0.0);
+            EXPECT_GE(moments.mode, (float)INT_MIN);
+            EXPECT_LE(moments.mode, (float)INT_MAX);
+        }
+    }
+
+    TEST(ImageHistTests, testHistFloatNative)
+    {
+        cv::Mat img(211, 157, CV_32F);
+        cv::randu(img, -5.0, 95.0);
+        img.at<float>(7, 7) = NAN;
+        img.at<float>(8, 8) = 100.0f;
+
+        float minVal = NAN;
+        float maxVal = NAN;
+        std::vector<float> bins;
+        std::vector<int> counts;
+        ImageUtil::histFloat(img, 50, minVal, maxVal, bins, counts);
+
+        // default min is 0 and max is the image max, negatives and nan are dropped
+        EXPECT_EQ(0.0f, minVal);
+        EXPECT_EQ(50, (int)counts.size());
+        EXPECT_NEAR(100.0f + 0.1f * 2.0f, maxVal, 1e-4f);
+
+        std::vector<int> expected(50);
+
+        for (int y = 0; y < img.rows; y++)
+        {
+            for (int x = 0; x < img.cols; x++)
+            {
+                float v = img.at<float>(y, x);
+
+                if ((v >= 0.0f) && (v <= 100.0f))
+                {
+                    expected[std::min(49, (int)(v * 50 / 100.0f))]++;
+                }
+            }
+        }
+
+        EXPECT_EQ(expected, counts);
+
+        // reuses the caller's storage
+        const int* countsData = counts.data();
+        minVal = 0.0f;
+        maxVal = 100.0f;
+        ImageUtil::histFloat(img, 50, minVal, maxVal, bins, counts);
+        EXPECT_EQ(countsData, counts.data());
+        EXPECT_EQ(expected, counts);
+    }
+
+    /**
+     * @brief Mask with an all-set block, an all-clear area, and scattered pixels (not all 255) so every 8-pixel case is hit.
+     */
+    static cv::Mat makeTestMask(int rows, int cols)
+    {
+        cv::Mat mask(rows, cols, CV_8U, cv::Scalar(0));
+        mask(cv::Rect(cols / 4, rows / 4, cols / 2, rows / 2)).setTo(255);
+
+        for (int y = 0; y < rows; y += 3)
+        {
+            for (int x = y % 5; x < cols; x += 7)
+            {
+                mask.at<uint8_t>(y, x) = (uint8_t)(1 + x % 3);
+            }
+        }
+
+        return mask;
+    }
+
+    TEST(ImageHistTests, testMaskedAndRoiHists)
+    {
+        std::vector<float> pcts = { 0, 10, 50, 90, 100 };
+
+        for (int type : { CV_8U, CV_16U, CV_16S, CV_32S, CV_32F })
+        {
+            cv::Mat img(123, 93, type);
+            cv::randu(img, -3000, 3000);
+            cv::Mat mask = makeTestMask(img.rows, img.cols);
+
+            if (type == CV_32F)
+            {
+                img.at<float>(60, 40) = NAN;
+            }
+
+            // masked values packed into a single column, the unmasked result on that is the expected masked result
+            cv::Mat img32f;
+            img.convertTo(img32f, CV_32F);
+            std::vector<float> values;
+
+            for (int y = 0; y < img.rows; y++)
+            {
+                for (int x = 0; x < img.cols; x++)
+                {
+                    if (mask.at<uint8_t>(y, x) != 0)
+                    {
+                        values.push_back(img32f.at<float>(y, x));
+                    }
+                }
+            }
+
+            cv::Mat packed(values);
+            EXPECT_EQ(ImageUtil::histPercentiles(packed, pcts), ImageUtil::histPercentiles(img, pcts, mask));
+
+            if ((type == CV_8U) || (type == CV_16U) || (type == CV_16S))
+            {
+                cv::Mat packedTyped;
+                packed.convertTo(packedTyped, type);
+                std::vector<int> counts;
+                ImageUtil::histInt(img, 2, counts, mask);
+                EXPECT_EQ(ImageUtil::histInt(packedTyped, 2), counts);
+                EXPECT_EQ(counts, ImageUtil::histInt(img, 2, mask));
+                EXPECT_EQ(ImageUtil::histInt(packedTyped), ImageUtil::histInt(img, mask));
+
+                // roi, mask is full size
+                cv::Rect roi(5, 9, 61, 70);
+                cv::Mat imgRoi = img(roi).clone();
+                cv::Mat maskRoi = mask(roi).clone();
+                std::vector<int> roiCounts;
+                ImageUtil::histInt(img, roi, 0, roiCounts, mask);
+                ImageUtil::histInt(imgRoi, 0, counts, maskRoi);
+                EXPECT_EQ(counts, roiCounts);
+
+                std::vector<float> roiResults;
+                ImageUtil::histPercentiles(img, roi, pcts, roiResults, mask);
+                EXPECT_EQ(ImageUtil::histPercentiles(imgRoi, pcts, maskRoi), roiResults);
+
+                if (type != CV_16S)
+                {
+                    EXPECT_EQ(ImageUtil::histPercentilesInt(imgRoi, 10, 90, maskRoi), ImageUtil::histPercentilesInt(img, roi, 10, 90, mask));
+                }
+            }
+
+            // the remaining roi overloads, same as on a copy of the roi
+            cv::Rect roi(7, 3, 50, 88);
+            cv::Mat imgRoi = img(roi).clone();
+            cv::Mat maskRoi = mask(roi).clone();
+
+            if (type == CV_32F)
+            {
+                EXPECT_EQ(ImageUtil::histPercentiles32f(imgRoi, 5, 95, 0.0f, maskRoi), ImageUtil::histPercentiles32f(img, roi, 5, 95, 0.0f, mask));
+            }
+            else
+            {
+                std::vector<int> roiCounts, copyCounts;
+                int roiOffset, roiShift, copyOffset, copyShift;
+                ImageUtil::histIntAdaptive(img, roi, 100, roiCounts, roiOffset, roiShift, mask);
+                ImageUtil::histIntAdaptive(imgRoi, 100, copyCounts, copyOffset, copyShift, maskRoi);
+                EXPECT_EQ(copyCounts, roiCounts);
+                EXPECT_EQ(copyOffset, roiOffset);
+                EXPECT_EQ(copyShift, roiShift);
+            }
+
+            float roiMin = 0.0f, roiMax = NAN, copyMin = 0.0f, copyMax = NAN;
+            std::vector<float> roiBins, copyBins;
+            std::vector<int> roiHist, copyHist;
+            ImageUtil::histFloat(img, roi, 20, roiMin, roiMax, roiBins, roiHist, mask);
+            ImageUtil::histFloat(imgRoi, 20, copyMin, copyMax, copyBins, copyHist, maskRoi);
+            EXPECT_EQ(copyMax, roiMax);
+            EXPECT_EQ(copyBins, roiBins);
+            EXPECT_EQ(copyHist, roiHist);
+
+            // sketch sees just the masked values
+            QuantileSketch sketch = ImageUtil::sketchImage(img, 100.0f, mask);
+            EXPECT_EQ(ImageUtil::computeStats(img, mask).count, (int64_t)sketch.getCount());
+            EXPECT_EQ(ImageUtil::histPercentiles(packed, { 0 })[0], sketch.getMin());
+            EXPECT_EQ(ImageUtil::histPercentiles(packed, { 100 })[0], sketch.getMax());
+
+            FloatHist expected = ImageUtil::histFloat(packed, 20, 0.0f, NAN);
+            FloatHist actual = ImageUtil::histFloat(img, 20, 0.0f, NAN, mask);
+            EXPECT_EQ(expected.maxVal, actual.maxVal);
+            EXPECT_EQ(expected.counts, actual.counts);
+        }
+
+        // everything masked out
+        cv::Mat img(20, 20, CV_32F, cv::Scalar(1.0));
+        cv::Mat none(20, 20, CV_8U, cv::Scalar(0));
+        std::vector<float> results = ImageUtil::histPercentiles(img, pcts, none);
+        EXPECT_TRUE(std::isnan(results[2]));
+
+        cv::Mat imgInt(20, 20, CV_32S, cv::Scalar(1));
+        std::vector<int> counts;
+        int offset, binShift;
+        ImageUtil::histIntAdaptive(imgInt, 100, counts, offset, binShift, none);
+        EXPECT_TRUE(counts.empty());
+
+        cv::Mat img8(20, 20, CV_8U, cv::Scalar(9));
+        EXPECT_EQ(std::make_pair(0, 0), ImageUtil::histPercentilesInt(img8, 10, 90, none));
+        EXPECT_TRUE(std::isnan(ImageUtil::histPercentiles(img8, 10, 90, none).first));
+    }
+
+    TEST(ImageHistTests, testAdaptiveMaskedOutOfRange)
+    {
+        // masked-out values far outside the masked range must not be binned
+        for (int type : { CV_16S, CV_32S })
+        {
+            int far = (type == CV_16S) ? 32000 : 2000000000;
+            cv::Mat img(61, 45, type, cv::Scalar(-far));
+            img(cv::Rect(0, 30, img.cols, 31)).setTo(far);
+            cv::Mat mask = makeTestMask(img.rows, img.cols);
+            std::vector<int> values;
+
+            for (int y = 0; y < img.rows; y++)
+            {
+                for (int x = 0; x < img.cols; x++)
+                {
+                    if (mask.at<uint8_t>(y, x) != 0)
+                    {
+                        int v = 100 + (y * 7 + x * 3) % 101;
+                        values.push_back(v);
+
+                        if (type == CV_16S)
+                        {
+                            img.at<int16_t>(y, x) = (int16_t)v;
+                        }
+                        else
+                        {
+                            img.at<int32_t>(y, x) = v;
+                        }
+                    }
+                }
+            }
+
+            std::vector<int> counts;
+            int offset, binShift;
+            ImageUtil::histIntAdaptive(img, 64, counts, offset, binShift, mask);
+            EXPECT_EQ(*std::min_element(values.begin(), values.end()), offset);
+
+            std::vector<int> expected(counts.size());
+
+            for (int v : values)
+            {
+                expected[(v - offset) >> binShift]++;
+            }
+
+            EXPECT_EQ(expected, counts);
+        }
+    }
+}
@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <fmt/core.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+
+using namespace std;
+using namespace CppOpenCVUtil;
+
+namespace CppOpenCVUtilTests
+{
+    static void expectStatsNear(const ImageUtil::ImageStats& expected, const ImageUtil::ImageStats& actual)
+    {
+        EXPECT_EQ(expected.type, actual.type);
+        EXPECT_EQ(expected.width, actual.width);
+        EXPECT_EQ(expected.height, actual.height);
+        EXPECT_EQ(expected.count, actual.count);
+        EXPECT_EQ(expected.nonzeroCount, actual.nonzeroCount);
+        EXPECT_FLOAT_EQ(expected.minVal, actual.minVal);
+        EXPECT_FLOAT_EQ(expected.maxVal, actual.maxVal);
+        EXPECT_NEAR(expected.sum, actual.sum, 1e-6 * std::abs(expected.sum) + 1e-3);
+        EXPECT_NEAR(expected.mean, actual.mean, 1e-6 * std::abs(expected.mean) + 1e-6);
+        EXPECT_NEAR(expected.variance, actual.variance, 1e-4 * expected.variance + 1e-6);
+    }
+
+    static cv::Mat generateRandomImage(int rows, int cols, int type, double lowVal, double highVal)
+    {
+        cv::Mat img(rows, cols, type);
+        cv::randu(img, lowVal, highVal);
+
+        // some zeros
+        img(cv::Rect(0, 0, cols / 4, rows / 4)).setTo(cv::Scalar(0));
+
+        return img;
+    }
+
+    TEST(ImageStatsTests, testComputeStatsMatchesMultiPass)
+    {
+        std::vector<std::pair<int, double>> typesAndMax = { { CV_8U, 256 }, { CV_16U, 65536 }, { CV_32S, 1e6 }, { CV_32F, 1000 } };
+
+        for (auto& t : typesAndMax)
+        {
+            cv::Mat img = generateRandomImage(301, 257, t.first, -t.second / 4, t.second);
+            ImageUtil::ImageStats expected = ImageUtil::computeStatsMultiPass(img);
+            ImageUtil::ImageStats actual = ImageUtil::computeStats(img);
+            expectStatsNear(expected, actual);
+
+            // non-continuous
+            cv::Mat roi = img(cv::Rect(3, 5, 200, 250));
+            expectStatsNear(ImageUtil::computeStatsMultiPass(roi), ImageUtil::computeStats(roi));
+        }
+    }
+
+    TEST(ImageStatsTests, testComputeStatsSkipsNan)
+    {
+        cv::Mat img(4, 4, CV_32F);
+        img = 2.0f;
+        img.at<float>(1, 1) = NAN;
+        img.at<float>(2, 2) = 6.0f;
+
+        ImageUtil::ImageStats stats = ImageUtil::computeStats(img);
+        EXPECT_EQ(15, stats.count);
+        EXPECT_EQ(15, stats.nonzeroCount);
+        EXPECT_FLOAT_EQ(2.0f, stats.minVal);
+        EXPECT_FLOAT_EQ(6.0f, stats.maxVal);
+        EXPECT_DOUBLE_EQ(34.0, stats.sum);
+
+        img = NAN;
+        stats = ImageUtil::computeStats(img);
+        EXPECT_EQ(0, stats.count);
+        EXPECT_TRUE(std::isnan(stats.minVal));
+    }
+
+    TEST(ImageStatsTests, testComputeStatsAllInf)
+    {
+        cv::Mat img(4, 4, CV_32F);
+        img = INFINITY;
+        ImageUtil::ImageStats stats = ImageUtil::computeStats(img);
+        EXPECT_EQ(16, stats.count);
+        EXPECT_EQ(INFINITY, stats.minVal);
+        EXPECT_EQ(INFINITY, stats.maxVal);
+
+        img = -INFINITY;
+        stats = ImageUtil::computeStats(img);
+        EXPECT_EQ(-INFINITY, stats.minVal);
+        EXPECT_EQ(-INFINITY, stats.maxVal);
+
+        cv::Mat img64(4, 4, CV_64FC2, cv::Scalar(-INFINITY, INFINITY));
+        stats = ImageUtil::computeStats(img64);
+        EXPECT_EQ(-INFINITY, stats.channelStats[0].maxVal);
+        EXPECT_EQ(INFINITY, stats.channelStats[1].minVal);
+    }
+
+    TEST(ImageStatsTests, testComputeStatsMultiChannel)
+    {
+        for (int type : { CV_8UC3, CV_32FC3 })
+        {
+            cv::Mat img = generateRandomImage(97, 113, type, 0, 200);
+            ImageUtil::ImageStats stats = ImageUtil::computeStats(img);
+            EXPECT_EQ(3, stats.channels);
+            EXPECT_EQ(97 * 113 * 3, stats.count);
+
+            std::vector<cv::Mat> planes;
+            cv::split(img, planes);
+            double sum = 0;
+
+            for (int c = 0; c < 3; c++)
+            {
+                ImageUtil::ImageStats expected = ImageUtil::computeStatsMultiPass(planes[c]);
+                const ImageUtil::ChannelStats& cs = stats.channelStats[c];
+                EXPECT_EQ(expected.count, cs.count);
+                EXPECT_EQ(expected.nonzeroCount, cs.nonzeroCount);
+                EXPECT_FLOAT_EQ(expected.minVal, cs.minVal);
+                EXPECT_FLOAT_EQ(expected.maxVal, cs.maxVal);
+                EXPECT_NEAR(expected.mean, cs.mean, 1e-6 * expected.mean);
+                EXPECT_NEAR(expected.variance, cs.variance, 1e-4 * expected.variance);
+                sum += expected.sum;
+            }
+
+            EXPECT_NEAR(sum, stats.sum, 1e-6 * sum);
+        }
+    }
+
+    TEST(ImageStatsTests, testComputeStatsRoiAndMask)
+    {
+        cv::Mat img = generateRandomImage(64, 80, CV_16U, 1, 1000);
+        cv::Mat mask = cv::Mat::zeros(img.rows, img.cols, CV_8U);
+        mask(cv::Rect(10, 20, 30, 10)).setTo(cv::Scalar(255));
+
+        // mask
+        cv::Scalar mean, stdDev;
+        cv::meanStdDev(img, mean, stdDev, mask);
+        ImageUtil::ImageStats stats = ImageUtil::computeStats(img, mask);
+        EXPECT_EQ(300, stats.count);
+        EXPECT_NEAR(mean[0], stats.mean, 1e-9);
+        EXPECT_NEAR(stdDev[0] * stdDev[0], stats.variance, 1e-6);
+
+        // roi, should be the same as cropping
+        cv::Rect roi(5, 15, 40, 30);
+        cv::Mat cropped = img(roi).clone();
+        expectStatsNear(ImageUtil::computeStatsMultiPass(cropped), ImageUtil::computeStats(img, roi));
+
+        // roi and mask
+        stats = ImageUtil::computeStats(img, roi, mask);
+        EXPECT_EQ(40, stats.width);
+        EXPECT_EQ(300, stats.count);
+        EXPECT_NEAR(mean[0], stats.mean, 1e-9);
+    }
+
+    TEST(ImageStatsTests, testImgMinMaxNan)
+    {
+        cv::Mat img(33, 47, CV_32F);
+        cv::randu(img, -10.0, 10.0);
+        img.at<float>(0, 0) = NAN;
+        img.at<float>(5, 46) = NAN;
+        img.at<float>(7, 7) = -50.0f;
+        img.at<float>(32, 46) = 60.0f;
+
+        int64_t nanCount, infCount;
+        std::pair<float, float> minMax = ImageUtil::imgMinMax(img, nanCount, infCount);
+        EXPECT_EQ(-50.0f, minMax.first);
+        EXPECT_EQ(60.0f, minMax.second);
+        EXPECT_EQ(2, nanCount);
+        EXPECT_EQ(0, infCount);
+
+        img.at<float>(1, 1) = INFINITY;
+        minMax = ImageUtil::imgMinMax(img, nanCount, infCount);
+        EXPECT_EQ(INFINITY, minMax.second);
+        EXPECT_EQ(1, infCount);
+
+        img = NAN;
+        minMax = ImageUtil::imgMinMax(img);
+        EXPECT_TRUE(std::isnan(minMax.first));
+        EXPECT_TRUE(std::isnan(minMax.second));
+    }
+
+    TEST(ImageStatsTests, testImgMinMaxAllTypes)
+    {
+        for (int type : { CV_8U, CV_16U, CV_16S, CV_32S, CV_64F, CV_32FC3 })
+        {
+            cv::Mat img = generateRandomImage(123, 71, type, -1000, 1000);
+            img = img(cv::Rect(1, 2, 67, 113));
+
+            double minVal, maxVal;
+            ImageUtil::imgMinMax(img, minVal, maxVal);
+
+            double expectedMin, expectedMax;
+            cv::minMaxLoc(img.reshape(1), &expectedMin, &expectedMax);
+            EXPECT_EQ(expectedMin, minVal);
+            EXPECT_EQ(expectedMax, maxVal);
+        }
+    }
+
+    TEST(ImageStatsTests, testImgMinMaxLoc)
+    {
+        for (int type : { CV_8U, CV_16S, CV_32F })
+        {
+            cv::Mat img = generateRandomImage(211, 97, type, -100, 100);
+
+            cv::Point expectedMinLoc, expectedMaxLoc;
+            double expectedMin, expectedMax;
+            cv::minMaxLoc(img, &expectedMin, &expectedMax, &expectedMinLoc, &expectedMaxLoc);
+
+            ImageUtil::MinMaxLoc mml = ImageUtil::imgMinMaxLoc(img);
+            EXPECT_EQ(expectedMin, mml.minVal);
+            EXPECT_EQ(expectedMax, mml.maxVal);
+            EXPECT_EQ(expectedMinLoc, mml.minLoc);
+            EXPECT_EQ(expectedMaxLoc, mml.maxLoc);
+
+            // roi and mask, locations in image coordinates
+            cv::Rect roi(10, 20, 50, 150);
+            cv::Mat mask = cv::Mat::zeros(img.rows, img.cols, CV_8U);
+            mask(cv::Rect(30, 40, 20, 100)).setTo(cv::Scalar(255));
+            cv::minMaxLoc(img, &expectedMin, &expectedMax, &expectedMinLoc, &expectedMaxLoc, mask);
+
+            mml = ImageUtil::imgMinMaxLoc(img, roi, mask);
+            EXPECT_EQ(expectedMin, mml.minVal);
+            EXPECT_EQ(expectedMax, mml.maxVal);
+            EXPECT_EQ(expectedMinLoc, mml.minLoc);
+            EXPECT_EQ(expectedMaxLoc, mml.maxLoc);
+        }
+
+        // nan skipped, empty mask gives no location
+        cv::Mat img(8, 8, CV_32F, cv::Scalar(1));
+        img.at<float>(2, 5) = NAN;
+        img.at<float>(4, 1) = -3.0f;
+        ImageUtil::MinMaxLoc mml = ImageUtil::imgMinMaxLoc(img);
+        EXPECT_EQ(cv::Point(1, 4), mml.minLoc);
+        EXPECT_EQ(cv::Point(0, 0), mml.maxLoc);
+
+        mml = ImageUtil::imgMinMaxLoc(img, cv::Mat::zeros(8, 8, CV_8U));
+        EXPECT_EQ(cv::Point(-1, -1), mml.minLoc);
+        EXPECT_TRUE(std::isnan(mml.minVal));
+    }
+
+    /**
+     * @brief Not a correctness test, prints single-pass vs multi-pass timing on a 16U image.
+     * Disabled so the default run stays quiet, run it with --gtest_also_run_disabled_tests.
+     */
+    TEST(ImageStatsTests, DISABLED_benchComputeStats)
+    {
+        cv::Mat img = generateRandomImage(2048, 2048, CV_16U, 0, 65536);
+        const int iterCount = 5;
+        ImageUtil::ImageStats fused, multi;
+
+        int64_t t0 = cv::getTickCount();
+
+        for (int i = 0; i < iterCount; i++)
+        {
+            multi = ImageUtil::computeStatsMultiPass(img);
+        }
+
+        int64_t t1 = cv::getTickCount();
+
+        for (int i = 0; i < iterCount; i++)
+        {
+            fused = ImageUtil::computeStats(img);
+        }
+
+        int64_t t2 = cv::getTickCount();
+
+        double msMulti = (t1 - t0) * 1000.0 / cv::getTickFrequency() / iterCount;
+        double msFused = (t2 - t1) * 1000.0 / cv::getTickFrequency() / iterCount;
+        fmt::print("computeStats 16U {}x{}: multi-pass {:.2f} ms, fused {:.2f} ms\n", img.cols, img.rows, msMulti, msFused);
+
+        expectStatsNear(multi, fused);
+    }
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 #include <string>
+#include <mutex>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
 #include <fmt/core.h>
 
 #include <opencv2/opencv.hpp>
@@ -82,4 +86,377 @@ namespace CppOpenCVUtilTests
 
         EXPECT_EQ(spec.imageWidthPx, collage.cols);
     }
+
+    /**
+     * @brief The original one-tile-at-a-time renderCollage, each caption drawn right after its tile.
+     */
+    static void renderCollageSerial(const std::vector<cv::Mat>& images, const std::vector<std::string>& captions, const ImageUtil::CollageSpec& spec, cv::Mat& dst)
+    {
+        int imgCount = (int)images.size();
+        cv::Scalar captionColor = spec.doBlackBackground ? cv::Scalar(255, 255, 255) : cv::Scalar(0, 0, 0);
+        int baseline;
+        int exampleTextHeight = cv::getTextSize(std::string("Foo1"), spec.fontFace, spec.fontScale, 1, &baseline).height;
+        int captionMargin = exampleTextHeight / 2;
+        int totalMarginCol = (spec.colCount + 1) * spec.marginPx;
+        int subImgWidth = (spec.imageWidthPx - totalMarginCol) / spec.colCount;
+        int rowCount = (imgCount + spec.colCount - 1) / spec.colCount;
+        double imgScale = ((double)spec.imageWidthPx - totalMarginCol) / (spec.colCount * images[0].cols);
+        int subImgHeight = (int)(imgScale * images[0].rows);
+        int totalTextHeight = 2 * captionMargin + exampleTextHeight;
+        int fullHeight = subImgHeight * rowCount + spec.marginPx * (rowCount + 1) + rowCount * totalTextHeight;
+
+        dst.create(fullHeight, spec.imageWidthPx, CV_8UC3);
+        dst.setTo(spec.doBlackBackground ? cv::Scalar(0, 0, 0) : cv::Scalar(255, 255, 255));
+
+        for (int i = 0; i < imgCount; i++)
+        {
+            int row = i / spec.colCount;
+            int col = i % spec.colCount;
+            cv::Mat imgScaled;
+            cv::resize(images[i], imgScaled, cv::Size(subImgWidth, subImgHeight));
+            int x = col * imgScaled.cols + (col + 1) * spec.marginPx;
+            int y = row * imgScaled.rows + (row + 1) * spec.marginPx + row * totalTextHeight;
+
+            if (imgScaled.type() == CV_8UC1)
+            {
+                cv::cvtColor(imgScaled, imgScaled, cv::COLOR_GRAY2RGB);
+            }
+
+            imgScaled.copyTo(dst(cv::Rect(x, y, imgScaled.cols, imgScaled.rows)));
+            std::string s = captions[i];
+            cv::Size textSize = cv::getTextSize(s, spec.fontFace, spec.fontScale, 1, &baseline);
+
+            while (textSize.width >= subImgWidth)
+            {
+                s = s.substr(0, s.size() - 1);
+                textSize = cv::getTextSize(s, spec.fontFace, spec.fontScale, 1, &baseline);
+            }
+
+            cv::Point textOrg(x + (imgScaled.cols - textSize.width) / 2, y + imgScaled.rows + textSize.height + captionMargin);
+            cv::putText(dst, s, textOrg, spec.fontFace, spec.fontScale, captionColor, 1, cv::LINE_AA);
+        }
+    }
+
+    TEST(ImageUtilTests, testRenderCollageMatchesSerial)
+    {
+        std::vector<cv::Mat> images;
+        std::vector<std::string> captions;
+        ImageUtil::CollageSpec spec;
+        spec.colCount = 5;
+        spec.imageWidthPx = 1000;
+
+        for (int i = 0; i < 23; i++)
+        {
+            cv::Mat img = generateBrightSpotImage(120 + i, 160, 200, i);
+
+            if (i % 3 == 0)
+            {
+                cv::cvtColor(img, img, cv::COLOR_GRAY2BGR);
+            }
+
+            images.push_back(img);
+            captions.push_back(fmt::format("image_{}_{}.png", i, std::string(i * 2, 'x')));
+        }
+
+        cv::Mat expected, actual;
+        renderCollageSerial(images, captions, spec, expected);
+        ImageUtil::renderCollage(images, captions, spec, actual);
+        ASSERT_EQ(expected.size(), actual.size());
+        EXPECT_EQ(0, cv::norm(expected, actual, cv::NORM_INF));
+
+        // same output on one thread
+        int threadCount = cv::getNumThreads();
+        cv::setNumThreads(1);
+        cv::Mat serial;
+        ImageUtil::renderCollage(images, captions, spec, serial);
+        cv::setNumThreads(threadCount);
+        EXPECT_EQ(0, cv::norm(serial, actual, cv::NORM_INF));
+    }
+
+    TEST(ImageUtilTests, testRenderCollageBands)
+    {
+        std::vector<cv::Mat> images;
+        std::vector<std::string> captions;
+        ImageUtil::CollageSpec spec;
+        spec.colCount = 4;
+        spec.imageWidthPx = 700;
+
+        for (int i = 0; i < 14; i++)
+        {
+            images.push_back(generateBrightSpotImage(100, 130, 100, i));
+            captions.push_back(fmt::format("tile {}", i));
+        }
+
+        cv::Mat expected;
+        ImageUtil::renderCollage(images, captions, spec, expected);
+        EXPECT_EQ(expected.size(), ImageUtil::getCollageSize((int)images.size(), images[0].size(), spec));
+
+        for (int tileRowsPerBand : { 1, 3 })
+        {
+            cv::Mat actual(expected.size(), CV_8UC3, cv::Scalar(1, 2, 3));
+            int nextY = 0;
+            int bandCount = 0;
+
+            ImageUtil::renderCollageBands(images, captions, spec, [&](const cv::Mat& band, int y)
+            {
+                // bands are in order and cover the collage
+                EXPECT_EQ(nextY, y);
+                band.copyTo(actual(cv::Rect(0, y, band.cols, band.rows)));
+                nextY += band.rows;
+                bandCount++;
+            }, tileRowsPerBand);
+
+            EXPECT_EQ(expected.rows, nextY);
+            EXPECT_EQ((4 + tileRowsPerBand - 1) / tileRowsPerBand, bandCount);
+            EXPECT_EQ(0, cv::norm(expected, actual, cv::NORM_INF));
+        }
+    }
+
+    TEST(ImageUtilTests, testRenderCollageLazyLoading)
+    {
+        std::vector<cv::Mat> images;
+        std::vector<std::string> captions;
+        std::vector<std::string> paths;
+        ImageUtil::CollageSpec spec;
+        spec.colCount = 3;
+        spec.imageWidthPx = 600;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        for (int i = 0; i < 8; i++)
+        {
+            images.push_back(generateBrightSpotImage(90, 120, 100, i));
+            captions.push_back(fmt::format("file_{}.png", i));
+            paths.push_back((dir / fmt::format("cppcvutil_collage_{}.png", i)).string());
+            cv::imwrite(paths.back(), images.back());
+        }
+
+        cv::Mat expected;
+        ImageUtil::renderCollage(images, captions, spec, expected);
+
+        // loader, each image loaded once, and with the tile size after the first
+        std::vector<int> loadCounts(images.size());
+        cv::Size lastTileSize;
+        std::mutex mutex;
+
+        auto loader = [&](int i, cv::Size tileSize)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            loadCounts[i]++;
+
+            if (i > 0)
+            {
+                lastTileSize = tileSize;
+            }
+
+            return images[i].clone();
+        };
+
+        cv::Mat actual;
+        ImageUtil::renderCollage((int)images.size(), loader, captions, spec, actual, 2);
+        EXPECT_EQ(0, cv::norm(expected, actual, cv::NORM_INF));
+        EXPECT_EQ(std::vector<int>(images.size(), 1), loadCounts);
+        EXPECT_EQ(cv::Size((600 - 4 * spec.marginPx) / 3, (int)(90 * ((600.0 - 4 * spec.marginPx) / (3 * 120)))), lastTileSize);
+
+        // files, gray decodes as color which renders the same
+        cv::Mat fromFiles;
+        ImageUtil::renderCollage(paths, captions, spec, fromFiles);
+        EXPECT_EQ(0, cv::norm(expected, fromFiles, cv::NORM_INF));
+
+        for (const std::string& path : paths)
+        {
+            std::filesystem::remove(path);
+        }
+    }
+
+    /**
+     * @brief Copy a JPEG, adding an EXIF APP1 segment with just an orientation tag after the SOI marker.
+     */
+    static void copyJpegWithOrientation(const std::string& srcPath, const std::string& dstPath, int orientation)
+    {
+        std::ifstream in(srcPath, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        // little-endian TIFF header, then IFD0 with one SHORT entry for tag 0x0112
+        const uint8_t app1[] = {
+            0xFF, 0xE1, 0, 34,
+            'E', 'x', 'i', 'f', 0, 0,
+            'I', 'I', 42, 0, 8, 0, 0, 0,
+            1, 0,
+            0x12, 0x01, 3, 0, 1, 0, 0, 0, (uint8_t)orientation, 0, 0, 0,
+            0, 0, 0, 0
+        };
+
+        std::ofstream out(dstPath, std::ios::binary);
+        out.write(bytes.data(), 2);
+        out.write((const char*)app1, sizeof(app1));
+        out.write(bytes.data() + 2, bytes.size() - 2);
+    }
+
+    TEST(ImageUtilTests, testLoadCollageImageJpeg)
+    {
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+        std::string path = (dir / "cppcvutil_collage_reduced.jpg").string();
+        std::string rotatedPath = (dir / "cppcvutil_collage_rotated.jpg").string();
+        cv::Mat img(600, 800, CV_8UC3);
+        cv::randu(img, 0, 256);
+        ASSERT_TRUE(cv::imwrite(path, img));
+
+        // the most reduction that still covers the tile
+        EXPECT_EQ(cv::Size(800, 600), ImageUtil::loadCollageImage(path, cv::Size()).size());
+        EXPECT_EQ(cv::Size(100, 75), ImageUtil::loadCollageImage(path, cv::Size(100, 75)).size());
+        EXPECT_EQ(cv::Size(200, 150), ImageUtil::loadCollageImage(path, cv::Size(101, 75)).size());
+        EXPECT_EQ(cv::Size(400, 300), ImageUtil::loadCollageImage(path, cv::Size(200, 151)).size());
+        EXPECT_EQ(cv::Size(800, 600), ImageUtil::loadCollageImage(path, cv::Size(401, 300)).size());
+
+        // rotated 90 degrees by EXIF, which imread applies, so the tile is compared to the rotated size
+        copyJpegWithOrientation(path, rotatedPath, 6);
+        EXPECT_EQ(cv::Size(600, 800), ImageUtil::loadCollageImage(rotatedPath, cv::Size()).size());
+        EXPECT_EQ(cv::Size(75, 100), ImageUtil::loadCollageImage(rotatedPath, cv::Size(75, 100)).size());
+        EXPECT_EQ(cv::Size(300, 400), ImageUtil::loadCollageImage(rotatedPath, cv::Size(200, 100)).size());
+
+        std::filesystem::remove(path);
+        std::filesystem::remove(rotatedPath);
+    }
+
+    TEST(ImageUtilTests, testFitTextToWidth)
+    {
+        int fontFace = cv::FONT_HERSHEY_DUPLEX;
+        double fontScale = 0.6;
+        int baseline;
+        std::string text = "C:/Images/2023/session_0042/camera_B/frame_000123_exposure_50ms.tif";
+
+        for (int maxWidth : { 0, 5, 40, 100, 173, 250, 400, 2000 })
+        {
+            // same as shortening one character at a time
+            std::string expected = text;
+
+            while (!expected.empty() && cv::getTextSize(expected, fontFace, fontScale, 1, &baseline).width > maxWidth)
+            {
+                expected.pop_back();
+            }
+
+            cv::Size textSize;
+            EXPECT_EQ(expected, ImageUtil::fitTextToWidth(text, maxWidth, fontFace, fontScale, 1, false, &textSize));
+
+            if (!expected.empty())
+            {
+                EXPECT_LE(textSize.width, maxWidth);
+            }
+
+            // with ellipsis, longest prefix plus "..." that fits
+            std::string withEllipsis = ImageUtil::fitTextToWidth(text, maxWidth, fontFace, fontScale, 1, true);
+
+            if (withEllipsis == text || withEllipsis.empty())
+            {
+                continue;
+            }
+
+            ASSERT_GE(withEllipsis.size(), 3u);
+            EXPECT_EQ("...", withEllipsis.substr(withEllipsis.size() - 3));
+            EXPECT_LE(cv::getTextSize(withEllipsis, fontFace, fontScale, 1, &baseline).width, maxWidth);
+
+            size_t prefixLen = withEllipsis.size() - 3;
+            EXPECT_EQ(text.substr(0, prefixLen), withEllipsis.substr(0, prefixLen));
+            EXPECT_GT(cv::getTextSize(text.substr(0, prefixLen + 1) + "...", fontFace, fontScale, 1, &baseline).width, maxWidth);
+        }
+    }
+
+    TEST(ImageUtilTests, testAutoContrastTo8u)
+    {
+        cv::Mat img16(50, 60, CV_16U);
+        cv::randu(img16, 1000, 3000);
+
+        // lut and direct give the same result, and percentiles land on 0 and 255
+        cv::Mat withLut, withoutLut;
+        ImageUtil::autoContrastTo8u(img16, withLut, 1.0f, 99.0f, true);
+        ImageUtil::autoContrastTo8u(img16, withoutLut, 1.0f, 99.0f, false);
+        ASSERT_EQ(CV_8U, withLut.type());
+        EXPECT_EQ(0, cv::countNonZero(withLut != withoutLut));
+
+        double minVal, maxVal;
+        cv::minMaxLoc(withLut, &minVal, &maxVal);
+        EXPECT_EQ(0, minVal);
+        EXPECT_EQ(255, maxVal);
+
+        // no absolute value on 32F, negatives below the low percentile go to 0
+        cv::Mat img32f(10, 10, CV_32F);
+        cv::randu(img32f, 0.0, 100.0);
+        img32f.at<float>(0, 0) = -1000.0f;
+        img32f.at<float>(0, 1) = NAN;
+        cv::Mat dst;
+        ImageUtil::autoContrastTo8u(img32f, dst, 1.0f, 99.0f);
+        EXPECT_EQ(0, dst.at<uint8_t>(0, 0));
+        EXPECT_EQ(0, dst.at<uint8_t>(0, 1));
+
+        // narrow data far from 0 is not quantized by the default exact percentiles
+        cv::Mat narrow(100, 100, CV_32F);
+        cv::randu(narrow, 1000.0, 1003.9);
+        ImageUtil::autoContrastTo8u(narrow, dst, 1.0f, 99.0f);
+        cv::minMaxLoc(dst, &minVal, &maxVal);
+        EXPECT_EQ(0, minVal);
+        EXPECT_EQ(255, maxVal);
+        EXPECT_GT(cv::mean(dst)[0], 64.0);
+        EXPECT_LT(cv::mean(dst)[0], 192.0);
+
+        cv::Mat saved;
+        EXPECT_TRUE(ImageUtil::convertForSave(narrow, "png", saved));
+        EXPECT_EQ(0, cv::countNonZero(saved != dst));
+    }
+
+    TEST(ImageUtilTests, testImgTo8uLutCurves)
+    {
+        cv::Mat img16(40, 50, CV_16U);
+        cv::randu(img16, 0, 60000);
+
+        for (ImageUtil::ToneCurve curve : { ImageUtil::ToneCurve::Linear, ImageUtil::ToneCurve::Gamma, ImageUtil::ToneCurve::Log })
+        {
+            cv::Mat withLut, withoutLut;
+            ImageUtil::imgTo8u(img16, withLut, 100.0f, 50000.0f, true, curve, 0.5f);
+            ImageUtil::imgTo8u(img16, withoutLut, 100.0f, 50000.0f, false, curve, 0.5f);
+            EXPECT_EQ(0, cv::countNonZero(withLut != withoutLut));
+        }
+
+        // the cached table is rebuilt when gamma changes
+        cv::Mat gammaHalf, gammaTwo;
+        ImageUtil::imgTo8u(img16, gammaHalf, 0.0f, 60000.0f, true, ImageUtil::ToneCurve::Gamma, 0.5f);
+        ImageUtil::imgTo8u(img16, gammaTwo, 0.0f, 60000.0f, true, ImageUtil::ToneCurve::Gamma, 2.0f);
+        EXPECT_GT(cv::sum(gammaHalf)[0], cv::sum(gammaTwo)[0]);
+
+        // linear lut matches the arithmetic stretch
+        cv::Mat linear;
+        ImageUtil::imgTo8u(img16, linear, 0.0f, 60000.0f, true);
+        uint16_t v = img16.at<uint16_t>(3, 4);
+        EXPECT_EQ(cv::saturate_cast<uint8_t>(v * (255.0f / 60000.0f)), linear.at<uint8_t>(3, 4));
+    }
+
+    TEST(ImageUtilTests, testImgToRgbStride)
+    {
+        cv::Mat img(5, 7, CV_8U);
+        cv::randu(img, 0, 256);
+        cv::Mat roi = img(cv::Rect(1, 1, 5, 3)); // non-continuous
+
+        // packed rgb
+        std::vector<uint8_t> rgb(roi.rows * roi.cols * 3);
+        ImageUtil::imgToRgb(roi, rgb.data());
+        EXPECT_EQ(roi.at<uint8_t>(2, 4), rgb[(2 * roi.cols + 4) * 3 + 1]);
+
+        // rgba with padded stride, padding untouched
+        size_t stride = roi.cols * 4 + 8;
+        std::vector<uint8_t> rgba(roi.rows * stride, 7);
+        ImageUtil::imgToRgb(roi, rgba.data(), stride, 4);
+        EXPECT_EQ(roi.at<uint8_t>(2, 4), rgba[2 * stride + 4 * 4 + 2]);
+        EXPECT_EQ(255, rgba[2 * stride + 4 * 4 + 3]);
+        EXPECT_EQ(7, rgba[stride - 1]);
+
+        // 8UC3 in, rgba out
+        cv::Mat img3(2, 2, CV_8UC3, cv::Scalar(1, 2, 3));
+        ImageUtil::imgToRgb(img3, rgba.data(), 0, 4);
+        EXPECT_EQ(3, rgba[2]);
+        EXPECT_EQ(255, rgba[3]);
+
+        // empty input writes nothing
+        cv::Mat empty;
+        EXPECT_NO_THROW(ImageUtil::imgToRgb(empty, rgba.data()));
+        EXPECT_EQ(3, rgba[2]);
+    }
 }
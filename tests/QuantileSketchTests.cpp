@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+#include "VectorUtil.h"
+
+using namespace std;
+using namespace CppBaseUtil;
+using namespace CppOpenCVUtil;
+
+namespace CppOpenCVUtilTests
+{
+    /**
+     * @brief Fraction of values lt v, to check sketch error in rank terms.
+     */
+    static double rankOf(const std::vector<float>& sorted, float v)
+    {
+        return (double)(std::lower_bound(sorted.begin(), sorted.end(), v) - sorted.begin()) / sorted.size();
+    }
+
+    TEST(QuantileSketchTests, testAccuracyAndSize)
+    {
+        // skewed values spanning several decades
+        std::vector<float> values = vectorRandomFloat(5, 200000, 0.0f, 5.0f);
+
+        for (float& v : values)
+        {
+            v = std::pow(10.0f, v);
+        }
+
+        QuantileSketch sketch;
+        sketch.add(values);
+        EXPECT_EQ(values.size(), sketch.getCount());
+        EXPECT_LE(sketch.getCentroidCount(), 200);
+
+        std::vector<float> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        EXPECT_EQ(sorted.front(), sketch.getPercentile(0));
+        EXPECT_EQ(sorted.back(), sketch.getPercentile(100));
+
+        for (float q : { 0.001f, 0.01f, 0.1f, 0.5f, 0.9f, 0.99f, 0.999f })
+        {
+            float estimate = sketch.getQuantile(q);
+            EXPECT_NEAR(q, rankOf(sorted, estimate), 0.02 * std::min(q, 1.0f - q) + 0.0005) << "q " << q;
+        }
+    }
+
+    TEST(QuantileSketchTests, testMergeAndSerialize)
+    {
+        std::vector<float> values = vectorRandomFloat(6, 50000, -100.0f, 100.0f);
+        std::vector<float> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+
+        QuantileSketch a, b;
+        a.add(std::span<const float>(values).first(20000));
+        b.add(std::span<const float>(values).subspan(20000));
+        b.add(NAN);
+        a.merge(b);
+        EXPECT_EQ(values.size(), a.getCount());
+
+        for (float q : { 0.01f, 0.5f, 0.99f })
+        {
+            EXPECT_NEAR(q, rankOf(sorted, a.getQuantile(q)), 0.005);
+        }
+
+        std::vector<uint8_t> data = a.serialize();
+        EXPECT_LT(data.size(), 8000);
+
+        QuantileSketch c;
+        c.deserialize(data.data(), data.size());
+        EXPECT_EQ(a.getCount(), c.getCount());
+        EXPECT_EQ(a.getMin(), c.getMin());
+        EXPECT_EQ(a.getQuantile(0.25f), c.getQuantile(0.25f));
+
+        EXPECT_THROW(c.deserialize(data.data(), data.size() - 1), std::exception);
+    }
+
+    TEST(QuantileSketchTests, testDeserializeRejectsBadData)
+    {
+        std::vector<float> values = vectorRandomFloat(7, 1000, 0.0f, 10.0f);
+        QuantileSketch a;
+        a.add(values);
+        const std::vector<uint8_t> good = a.serialize();
+
+        // layout: magic, compression, total weight, min, max, centroid count, then mean/weight pairs
+        const size_t compressionAt = 4;
+        const size_t countAt = 32;
+        const size_t firstWeightAt = 36 + sizeof(double);
+
+        QuantileSketch c;
+        c.add(5.0f);
+
+        auto expectRejected = [&](const std::vector<uint8_t>& data)
+        {
+            EXPECT_THROW(c.deserialize(data.data(), data.size()), std::exception);
+            EXPECT_EQ(1.0, c.getCount());
+            EXPECT_EQ(5.0f, c.getMin());
+            EXPECT_EQ(100.0f, c.compression);
+        };
+
+        for (float compression : { NAN, INFINITY, 0.0f, -5.0f })
+        {
+            std::vector<uint8_t> data = good;
+            memcpy(data.data() + compressionAt, &compression, sizeof(compression));
+            expectRejected(data);
+        }
+
+        std::vector<uint8_t> data = good;
+        data[countAt]++;
+        expectRejected(data);
+
+        data = good;
+        double weight = -1.0;
+        memcpy(data.data() + firstWeightAt, &weight, sizeof(weight));
+        expectRejected(data);
+
+        expectRejected(std::vector<uint8_t>(good.begin(), good.end() - 1));
+
+        c.deserialize(good.data(), good.size());
+        EXPECT_EQ(a.getCount(), c.getCount());
+
+        QuantileSketch empty;
+        std::vector<uint8_t> emptyData = empty.serialize();
+        c.deserialize(emptyData.data(), emptyData.size());
+        EXPECT_TRUE(c.empty());
+    }
+
+    TEST(QuantileSketchTests, testSketchImage)
+    {
+        cv::Mat img(300, 200, CV_16U);
+        cv::randu(img, 0, 4096);
+
+        QuantileSketch sketch = ImageUtil::sketchImage(img);
+        std::vector<float> pcts = { 1, 50, 99 };
+        std::vector<float> exact = ImageUtil::histPercentiles(img, pcts);
+        std::vector<float> estimates;
+        sketch.getPercentiles(pcts, estimates);
+
+        for (size_t i = 0; i < pcts.size(); i++)
+        {
+            EXPECT_NEAR(exact[i], estimates[i], 4096 * 0.005);
+        }
+    }
+}
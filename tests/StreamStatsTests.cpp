@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+#include <fmt/core.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+
+using namespace std;
+using namespace CppOpenCVUtil;
+
+namespace CppOpenCVUtilTests
+{
+    static void writeLe(std::ofstream& out, uint32_t val, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            out.put((char)((val >> (i * 8)) & 0xFF));
+        }
+    }
+
+    /**
+     * @brief Write a minimal little-endian uncompressed single-channel 16U TIFF with the given rows per strip.
+     */
+    static void writeStripTiff16u(const std::string& path, cv::Mat& img, int rowsPerStrip)
+    {
+        int stripCount = (img.rows + rowsPerStrip - 1) / rowsPerStrip;
+        uint32_t rowBytes = (uint32_t)img.cols * 2;
+        const int entryCount = 9;
+        uint32_t ifdOffset = 8;
+        uint32_t offsetsOffset = ifdOffset + 2 + entryCount * 12 + 4;
+        uint32_t countsOffset = offsetsOffset + stripCount * 4;
+        uint32_t dataOffset = countsOffset + stripCount * 4;
+
+        std::ofstream out(path, std::ios::binary);
+        out.write("II", 2);
+        writeLe(out, 42, 2);
+        writeLe(out, ifdOffset, 4);
+
+        auto entry = [&](int tag, int fieldType, uint32_t count, uint32_t val)
+        {
+            writeLe(out, tag, 2);
+            writeLe(out, fieldType, 2);
+            writeLe(out, count, 4);
+            writeLe(out, val, 4);
+        };
+
+        writeLe(out, entryCount, 2);
+        entry(256, 4, 1, img.cols);
+        entry(257, 4, 1, img.rows);
+        entry(258, 3, 1, 16);
+        entry(259, 3, 1, 1);
+        entry(262, 3, 1, 1);
+        entry(273, 4, stripCount, offsetsOffset);
+        entry(277, 3, 1, 1);
+        entry(278, 4, 1, rowsPerStrip);
+        entry(279, 4, stripCount, countsOffset);
+        writeLe(out, 0, 4);
+
+        for (int s = 0; s < stripCount; s++)
+        {
+            writeLe(out, dataOffset + s * rowsPerStrip * rowBytes, 4);
+        }
+
+        for (int s = 0; s < stripCount; s++)
+        {
+            writeLe(out, std::min(rowsPerStrip, img.rows - s * rowsPerStrip) * rowBytes, 4);
+        }
+
+        for (int y = 0; y < img.rows; y++)
+        {
+            for (int x = 0; x < img.cols; x++)
+            {
+                writeLe(out, img.at<uint16_t>(y, x), 2);
+            }
+        }
+    }
+
+    TEST(StreamStatsTests, testBandsMatchWholeImage)
+    {
+        std::vector<float> pcts = { 0, 1, 50, 99, 100 };
+
+        for (int type : { CV_8U, CV_16U, CV_16S })
+        {
+            cv::Mat img(301, 77, type);
+            cv::randu(img, -1000, 5000);
+
+            // bands of uneven size, split over two accumulators and merged
+            ImageUtil::StreamStats a(type), b(type);
+            int y = 0;
+
+            for (int bandRows : { 50, 1, 100, 17, 133 })
+            {
+                cv::Mat band = img(cv::Rect(0, y, img.cols, bandRows));
+                ((y < 150) ? a : b).add(band);
+                y += bandRows;
+            }
+
+            a.merge(b);
+
+            ImageUtil::ImageStats expected = ImageUtil::computeStats(img);
+            ImageUtil::ImageStats actual = a.getStats();
+            EXPECT_EQ(img.rows, actual.height);
+            EXPECT_EQ(expected.count, actual.count);
+            EXPECT_EQ(expected.nonzeroCount, actual.nonzeroCount);
+            EXPECT_FLOAT_EQ(expected.minVal, actual.minVal);
+            EXPECT_FLOAT_EQ(expected.maxVal, actual.maxVal);
+            EXPECT_NEAR(expected.mean, actual.mean, 1e-9 * std::abs(expected.mean));
+            EXPECT_NEAR(expected.variance, actual.variance, 1e-9 * expected.variance);
+
+            // exact for integer types
+            EXPECT_EQ(ImageUtil::histPercentiles(img, pcts), a.getPercentiles(pcts));
+        }
+    }
+
+    TEST(StreamStatsTests, test32fPercentilesWithinCoarseError)
+    {
+        cv::Mat img(200, 150, CV_32F);
+        cv::randu(img, -50.0, 1000.0);
+        img.at<float>(3, 3) = NAN;
+
+        ImageUtil::StreamStats acc(CV_32F);
+
+        for (int y = 0; y < img.rows; y += 64)
+        {
+            acc.add(img(cv::Rect(0, y, img.cols, std::min(64, img.rows - y))));
+        }
+
+        std::vector<float> pcts = { 0, 5, 50, 95, 100 };
+        std::vector<float> exact = ImageUtil::histPercentiles(img, pcts);
+        std::vector<float> approx = acc.getPercentiles(pcts);
+
+        for (size_t i = 0; i < pcts.size(); i++)
+        {
+            EXPECT_NEAR(exact[i], approx[i], std::abs(exact[i]) / 128.0f);
+        }
+
+        EXPECT_EQ(exact[0], approx[0]);
+        EXPECT_EQ(exact[4], approx[4]);
+        EXPECT_EQ(img.rows * img.cols - 1, acc.getStats().count);
+    }
+
+    TEST(StreamStatsTests, test32sLargeMinMaxMatchComputeStats)
+    {
+        cv::Mat img(4, 4, CV_32S, cv::Scalar(0));
+        img.at<int32_t>(1, 1) = (1 << 24) + 1;
+        img.at<int32_t>(2, 2) = -(1 << 30) - 3;
+
+        ImageUtil::StreamStats acc(CV_32S);
+        acc.add(img(cv::Rect(0, 0, 4, 2)));
+        acc.add(img(cv::Rect(0, 2, 4, 2)));
+
+        // min/max are float, so they match computeStats, rounded to 24 bits
+        ImageUtil::ImageStats whole = ImageUtil::computeStats(img);
+        ImageUtil::ImageStats streamed = acc.getStats();
+        EXPECT_EQ(whole.minVal, streamed.minVal);
+        EXPECT_EQ(whole.maxVal, streamed.maxVal);
+        EXPECT_EQ((float)((1 << 24) + 1), streamed.maxVal);
+
+        std::vector<float> ends = acc.getPercentiles({ 0.0f, 100.0f });
+        EXPECT_EQ(streamed.minVal, ends[0]);
+        EXPECT_EQ(streamed.maxVal, ends[1]);
+        EXPECT_DOUBLE_EQ(whole.sum, streamed.sum);
+    }
+
+    TEST(StreamStatsTests, testStripReaderRawAndTiff)
+    {
+        cv::Mat img(97, 61, CV_16U);
+        cv::randu(img, 0, 65536);
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        // raw, with a header to skip
+        std::string rawPath = (dir / "cppcvutil_strip_test.raw").string();
+        {
+            std::ofstream out(rawPath, std::ios::binary);
+            out.write("HEADER", 6);
+
+            for (int y = 0; y < img.rows; y++)
+            {
+                out.write((const char*)img.ptr(y), img.cols * 2);
+            }
+        }
+
+        ImageUtil::StripReader reader;
+        reader.openRaw(rawPath, img.cols, img.rows, CV_16U, 6);
+        cv::Mat band;
+        ASSERT_TRUE(reader.readBand(40, band));
+        EXPECT_EQ(40, band.rows);
+        EXPECT_EQ(0, cv::norm(band, img(cv::Rect(0, 0, img.cols, 40)), cv::NORM_INF));
+
+        ImageUtil::StreamStats stats = ImageUtil::computeStreamStats(reader, 25);
+        EXPECT_EQ((int64_t)(img.rows - 40) * img.cols, stats.getStats().count);
+        EXPECT_FALSE(reader.readBand(10, band));
+
+        // tiff, bands crossing strip boundaries
+        std::string tiffPath = (dir / "cppcvutil_strip_test.tif").string();
+        writeStripTiff16u(tiffPath, img, 13);
+        reader.openTiff(tiffPath);
+        EXPECT_EQ(img.cols, reader.getWidth());
+        EXPECT_EQ(img.rows, reader.getHeight());
+        EXPECT_EQ(CV_16U, reader.getType());
+
+        stats = ImageUtil::computeStreamStats(reader, 20);
+        ImageUtil::ImageStats expected = ImageUtil::computeStats(img);
+        EXPECT_EQ(expected.count, stats.getStats().count);
+        EXPECT_DOUBLE_EQ(expected.sum, stats.getStats().sum);
+        EXPECT_EQ(ImageUtil::histPercentiles(img, { 10, 50, 90 }), stats.getPercentiles({ 10, 50, 90 }));
+
+        reader.close();
+        std::filesystem::remove(rawPath);
+        std::filesystem::remove(tiffPath);
+    }
+
+    TEST(StreamStatsTests, testStripReaderTypes)
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "cppcvutil_strip_types_test.raw").string();
+        ImageUtil::StripReader reader;
+
+        // every type the reader accepts can be streamed into stats
+        for (int type : { CV_8U, CV_16U, CV_16S, CV_32S, CV_32F })
+        {
+            cv::Mat img(37, 23, type);
+            cv::randu(img, -1000, 5000);
+            {
+                std::ofstream out(path, std::ios::binary);
+                out.write((const char*)img.data, img.total() * img.elemSize());
+            }
+
+            reader.openRaw(path, img.cols, img.rows, type);
+            ImageUtil::StreamStats stats = ImageUtil::computeStreamStats(reader, 10);
+            ImageUtil::ImageStats expected = ImageUtil::computeStats(img);
+            EXPECT_EQ(expected.count, stats.getStats().count);
+            EXPECT_DOUBLE_EQ(expected.sum, stats.getStats().sum);
+            EXPECT_FLOAT_EQ(expected.minVal, stats.getStats().minVal);
+            EXPECT_FLOAT_EQ(expected.maxVal, stats.getStats().maxVal);
+        }
+
+        // and the rest are rejected up front
+        for (int type : { CV_8S, CV_64F, CV_16F, CV_8UC3 })
+        {
+            EXPECT_ANY_THROW(reader.openRaw(path, 23, 37, type));
+        }
+
+        reader.close();
+        std::filesystem::remove(path);
+    }
+
+    TEST(StreamStatsTests, testStripReaderBadEntries)
+    {
+        cv::Mat img(20, 10, CV_16U, cv::Scalar(7));
+        std::string path = (std::filesystem::temp_directory_path() / "cppcvutil_strip_bad_test.tif").string();
+        ImageUtil::StripReader reader;
+
+        // IFD entries start at 10 and are 12 bytes, the count is at 4 in each
+        auto patchCount = [&](int entryIdx, uint32_t count)
+        {
+            writeStripTiff16u(path, img, 5);
+            std::ofstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+            out.seekp(10 + entryIdx * 12 + 4);
+            writeLe(out, count, 4);
+        };
+
+        writeStripTiff16u(path, img, 5);
+        reader.openTiff(path);
+        EXPECT_EQ(img.rows, reader.getHeight());
+
+        // width with no values
+        patchCount(0, 0);
+        EXPECT_ANY_THROW(reader.openTiff(path));
+
+        // strip offsets with far more values than the file could hold
+        patchCount(5, 0x40000000);
+        EXPECT_ANY_THROW(reader.openTiff(path));
+
+        reader.close();
+        std::filesystem::remove(path);
+    }
+}
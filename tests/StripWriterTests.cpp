@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <filesystem>
+#include <fmt/core.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageUtil.h"
+
+using namespace std;
+using namespace CppOpenCVUtil;
+
+namespace CppOpenCVUtilTests
+{
+    TEST(StripWriterTests, testRoundTrip16u)
+    {
+        // wide enough for several strips
+        cv::Mat img(211, 2000, CV_16U);
+        cv::randu(img, 0, 65536);
+        std::string path = (std::filesystem::temp_directory_path() / "cppcvutil_strip_writer_test.tif").string();
+
+        ImageUtil::StripWriter writer;
+        writer.openTiff(path, img.cols, img.rows, img.type());
+        int y = 0;
+
+        for (int bandRows : { 7, 100, 1, 103 })
+        {
+            writer.writeBand(img(cv::Rect(0, y, img.cols, bandRows)));
+            y += bandRows;
+        }
+
+        EXPECT_EQ(img.rows, writer.getNextRow());
+        writer.close();
+
+        ImageUtil::StripReader reader;
+        reader.openTiff(path);
+        ASSERT_EQ(img.cols, reader.getWidth());
+        ASSERT_EQ(img.rows, reader.getHeight());
+        ASSERT_EQ(CV_16U, reader.getType());
+
+        cv::Mat band;
+        y = 0;
+
+        while (reader.readBand(64, band))
+        {
+            EXPECT_EQ(0, cv::norm(band, img(cv::Rect(0, y, img.cols, band.rows)), cv::NORM_INF));
+            y += band.rows;
+        }
+
+        EXPECT_EQ(img.rows, y);
+        reader.close();
+
+        // closing early is an error
+        writer.openTiff(path, 10, 10, CV_8UC3);
+        writer.writeBand(cv::Mat(4, 10, CV_8UC3, cv::Scalar(1, 2, 3)));
+        EXPECT_ANY_THROW(writer.close());
+        std::filesystem::remove(path);
+    }
+
+    TEST(StripWriterTests, testCollageSinkRoundTrip)
+    {
+        std::vector<cv::Mat> images;
+        std::vector<std::string> captions;
+        ImageUtil::CollageSpec spec;
+        spec.colCount = 3;
+        spec.imageWidthPx = 500;
+
+        // color and gray tiles, so the BGR to RGB swap on write shows up if it is wrong
+        for (int i = 0; i < 7; i++)
+        {
+            cv::Mat img(80, 100, (i % 2 == 0) ? CV_8UC3 : CV_8UC1);
+            cv::randu(img, 0, 256);
+            images.push_back(img);
+            captions.push_back(fmt::format("tile {}", i));
+        }
+
+        cv::Mat expected;
+        ImageUtil::renderCollage(images, captions, spec, expected);
+
+        std::string path = (std::filesystem::temp_directory_path() / "cppcvutil_collage_writer_test.tif").string();
+        ImageUtil::StripWriter writer;
+        writer.openTiff(path, expected.cols, expected.rows, CV_8UC3);
+        ImageUtil::renderCollageBands(images, captions, spec, writer.getCollageSink(), 2);
+        writer.close();
+
+        // read back by OpenCV, not the (single-channel) StripReader
+        cv::Mat actual = cv::imread(path, cv::IMREAD_UNCHANGED);
+        ASSERT_EQ(expected.size(), actual.size());
+        ASSERT_EQ(CV_8UC3, actual.type());
+        EXPECT_EQ(0, cv::norm(expected, actual, cv::NORM_INF));
+
+        std::filesystem::remove(path);
+    }
+}